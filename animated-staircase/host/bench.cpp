@@ -0,0 +1,116 @@
+/*
+ * Side by side benchmark of the runtime configured Animated_Staircase and a
+ * fixed Staircase_Usermod for the same installation (12 steps, PIR sensors
+ * at both ends). Both run the same walkers and have to produce the same
+ * segment timeline; the object size and loop() cost are printed for each.
+ */
+#include "../usermod_stairs.h"
+#include "sim.h"
+
+typedef Staircase_Usermod<12, STAIRS_BOTH_ENDS, STAIRS_SENSOR_PIR> Fixed_Staircase;
+
+static const uint8_t steps = 12;
+static const uint8_t topPin = 4;
+static const uint8_t bottomPin = 5;
+static const uint8_t switchPin = 13;
+static const int rounds = 3;     // The fastest round is reported
+static const int walkers = 40;
+
+static const char config[] =
+  "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"segment-delay-ms\":150,\"on-time-s\":10,"
+  "\"topPIRorTrigger_pin\":4,\"bottomPIRorTrigger_pin\":5}}";
+
+// Walkers from alternating ends, some of them meeting on the stairs, then
+// a quiet minute
+template<class UM>
+static std::vector<sim::Switch> bench(const char *name) {
+  sim::Stats best;
+  long latency = -1, cascade = -1;
+  std::vector<sim::Switch> timeline;
+  for (int round = 0; round < rounds; round++) {
+    UM um;
+    sim::reset(steps);
+    sim::setPin(switchPin, HIGH);
+    sim::begin(um, config);
+    sim::run(um, 13000);  // The lights enabling holds on go out
+    sim::resetStats();
+    sim::switches.clear();
+    sim::messages.clear();
+
+    unsigned long t0 = sim::nowUs;
+    for (int i = 0; i < walkers; i++) {
+      uint8_t pin = i & 1 ? topPin : bottomPin;
+      sim::setPin(pin, HIGH);
+      sim::run(um, 800);
+      sim::setPin(pin, LOW);
+      sim::run(um, i % 4 == 3 ? 14000 : 2500);  // Every fourth walker leaves the stairs empty
+    }
+    sim::run(um, 60000);
+    CHECK(sim::litSegments() == 0);
+
+    if (round == 0 || sim::stats.loopNs < best.loopNs) best = sim::stats;
+    // The first walker enters at the bottom, the cascade ends at the top step
+    long first = sim::firstSwitch(t0, true);
+    latency = first - t0;
+    cascade = -1;
+    for (const sim::Switch &s : sim::switches) {
+      if (s.on && s.segment == 0 && (long)(s.us - first) >= 0) { cascade = s.us - first; break; }
+    }
+    // Timestamps relative to the first walker, comparable between variants
+    timeline.clear();
+    for (sim::Switch s : sim::switches) {
+      s.us -= t0;
+      timeline.push_back(s);
+    }
+  }
+  sim::stats = best;
+  sim::report(name, latency, cascade);
+  printf("%-22s %zu bytes, %.2f ms host CPU in loop()\n", "", sizeof(UM), best.loopNs / 1e6);
+  return timeline;
+}
+
+int main() {
+  printf("%d walkers, %d staircase(s), trace buffer %d bytes\n", walkers, STAIRS_MAX_STAIRCASES, STAIRS_TRACE_BYTES);
+  std::vector<sim::Switch> runtime = bench<Animated_Staircase>("Animated_Staircase");
+  std::vector<sim::Switch> fixed = bench<Fixed_Staircase>("<12, BOTH_ENDS, PIR>");
+
+  // Same decisions, so the same switches at the same times
+  bool same = runtime.size() == fixed.size() && !runtime.empty();
+  for (size_t i = 0; same && i < runtime.size(); i++) {
+    same = runtime[i].us == fixed[i].us && runtime[i].segment == fixed[i].segment && runtime[i].on == fixed[i].on;
+  }
+  CHECK(same);
+  CHECK(sizeof(Fixed_Staircase) < sizeof(Animated_Staircase));
+
+  // The fixed variant on fewer segments than steps: the missing steps are
+  // left out, so the cascade runs over the segments that exist
+  {
+    const uint8_t segments = 8;
+    Fixed_Staircase um;
+    sim::reset(segments);
+    sim::setPin(switchPin, HIGH);
+    sim::begin(um, config);
+    sim::run(um, 13000);
+    CHECK(sim::litSegments() == 0);
+    sim::switches.clear();
+
+    unsigned long t0 = sim::nowUs;
+    sim::setPin(bottomPin, HIGH);
+    sim::run(um, 800);
+    sim::setPin(bottomPin, LOW);
+    sim::run(um, segments * 150 + 500);
+    CHECK(sim::litSegments() == segments);
+    CHECK(!sim::switches.empty() && sim::switches.front().segment == segments - 1);
+    long first = sim::firstSwitch(t0, true);
+    long cascade = sim::lastSwitch(t0, true) - first;
+    CHECK(first - (long)t0 <= 25000);  // Debouncing only
+    CHECK(cascade <= (long)((segments - 1) * 150 + 2) * 1000);
+    sim::run(um, 10000 + segments * 150 + 1000);
+    CHECK(sim::litSegments() == 0);
+    // Every segment is switched on and off exactly once
+    CHECK(sim::switches.size() == 2 * segments);
+    sim::report("<12> on 8 segments", first - t0, cascade);
+  }
+
+  return sim::failures ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * Ultrasonic sensors on synthetic echo timings: the simulation answers every
+ * trigger pulse with an echo pulse of distance * 58us (38ms without a
+ * target), and the usermod has to measure it from the interrupt edges
+ * without ever blocking loop().
+ */
+#include "../usermod_stairs.h"
+#include "sim.h"
+
+static const uint8_t steps = 12;
+static const uint8_t topTrig = 4, topEcho = 6;
+static const uint8_t bottomTrig = 5, bottomEcho = 7;
+static const uint8_t switchPin = 13;
+static const unsigned long stepDelay = 100;
+static const unsigned long onTime = 5000;
+static const unsigned long pingGap = 40;  // pingGap of the usermod, each of two sensors is pinged every 80ms
+
+static const char config[] =
+  "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"segment-delay-ms\":100,\"on-time-s\":5,"
+  "\"topPIRorTrigger_pin\":4,\"topEcho_pin\":6,\"topMaxDist_cm\":50,"
+  "\"bottomPIRorTrigger_pin\":5,\"bottomEcho_pin\":7,\"bottomMaxDist_cm\":80}}";
+
+// Last measured distance of an end, 0 = nothing in range
+static int distance(Animated_Staircase &um, bool top) {
+  DynamicJsonDocument doc;
+  sim::state(um, doc);
+  return doc["staircase"]["distance-cm"][top ? 0 : 1].as<int>();
+}
+
+static void settle(Animated_Staircase &um) {
+  sim::run(um, onTime + steps * stepDelay + 1000);
+  sim::resetStats();
+  sim::switches.clear();
+}
+
+int main() {
+  Animated_Staircase um;
+  sim::reset(steps);
+  sim::setPin(switchPin, HIGH);
+  sim::setDistance(topTrig, topEcho, 0);
+  sim::setDistance(bottomTrig, bottomEcho, 0);
+  sim::begin(um, config);
+  settle(um);
+  CHECK(sim::litSegments() == 0);
+
+  // Nothing in front of the sensors: 38ms echo pulses are no target
+  sim::run(um, 1000);
+  CHECK(distance(um, true) == 0 && distance(um, false) == 0);
+  CHECK(sim::switches.empty());
+  CHECK(sim::stats.loopMaxUs <= 10);  // Only the trigger pulse, never an echo wait
+  sim::report("echo-no-target", -1, -1);
+
+  // Targets beyond the thresholds are measured but do not count as motion
+  const uint16_t far[] = {51, 120, 250, 399};
+  for (uint16_t cm : far) {
+    sim::setDistance(topTrig, topEcho, cm);
+    sim::setDistance(bottomTrig, bottomEcho, cm + 30);
+    sim::run(um, 200);
+    CHECK(distance(um, true) == cm);
+    CHECK(distance(um, false) == cm + 30 || (cm + 30 > 400 && distance(um, false) == 0));  // Beyond 4m the echo times out
+  }
+  CHECK(sim::switches.empty());
+
+  // A walker steps in front of the bottom sensor
+  sim::setDistance(topTrig, topEcho, 0);
+  sim::setDistance(bottomTrig, bottomEcho, 0);
+  settle(um);
+  unsigned long t0 = sim::nowUs;
+  sim::setDistance(bottomTrig, bottomEcho, 75);
+  sim::run(um, 500);
+  sim::setDistance(bottomTrig, bottomEcho, 0);
+  sim::run(um, steps * stepDelay + 500);
+  CHECK(sim::litSegments() == steps);
+  CHECK(distance(um, false) == 0);
+  long first = sim::firstSwitch(t0, true);
+  CHECK(first >= 0 && sim::switches.front().segment == steps - 1);
+  // Each end is pinged every 80ms, plus the echo and min-pulse-ms of debouncing
+  CHECK(first - (long)t0 <= (long)(2 * pingGap + 5 + 20 + 1) * 1000);
+  CHECK(sim::stats.loopMaxUs <= 10);
+  sim::report("echo-bottom", first - t0, sim::lastSwitch(t0, true) - first);
+
+  // And leaves at the top, the stairs go dark after the on-time
+  sim::setDistance(topTrig, topEcho, 20);
+  sim::run(um, 500);
+  sim::setDistance(topTrig, topEcho, 0);
+  CHECK(distance(um, true) == 20);
+  sim::run(um, onTime + steps * stepDelay + 1000);
+  CHECK(sim::litSegments() == 0);
+  sim::report("echo-walk-through", -1, -1);
+
+  // A single sensor without a target: it is pinged every 60ms, after its
+  // 38ms echo has ended, so the tail of one echo is never read as the next
+  // (about 655cm)
+  {
+    Animated_Staircase single;
+    sim::reset(steps);
+    sim::setPin(switchPin, HIGH);
+    sim::setDistance(bottomTrig, bottomEcho, 0);
+    sim::begin(single, "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"segment-delay-ms\":100,\"on-time-s\":5,"
+                       "\"bottomPIRorTrigger_pin\":5,\"bottomEcho_pin\":7,\"bottomMaxDist_cm\":80}}");
+    settle(single);
+    for (int i = 0; i < 40; i++) {
+      sim::run(single, 25);
+      CHECK(distance(single, false) == 0);
+    }
+    sim::setDistance(bottomTrig, bottomEcho, 300);
+    sim::run(single, 200);
+    CHECK(distance(single, false) == 300);
+    CHECK(sim::switches.empty());
+    sim::report("echo-single-sensor", -1, -1);
+  }
+
+  return sim::failures ? 1 : 0;
+}
@@ -0,0 +1,359 @@
+/*
+ * Minimal stand-in for the part of ArduinoJson 6 the usermod uses, for the
+ * host build. Values live in a tree owned by a DynamicJsonDocument; the
+ * JsonObject, JsonArray and JsonVariant handles are cheap views into it.
+ * Supports reading with operator| defaults, writing scalars, nested
+ * objects and arrays, and parsing and serializing plain JSON text.
+ */
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct JsonNode {
+  enum Type { Null, Bool, Int, Float, String, Array, Object } type = Null;
+  bool b = false;
+  long long i = 0;
+  double f = 0;
+  std::string s;
+  std::vector<std::pair<std::string, std::unique_ptr<JsonNode>>> members;  // Object
+  std::vector<std::unique_ptr<JsonNode>> elements;                         // Array
+
+  void reset(Type t) {
+    type = t;
+    b = false; i = 0; f = 0;
+    s.clear(); members.clear(); elements.clear();
+  }
+  JsonNode *member(const char *key) const {
+    if (type != Object || !key) return nullptr;
+    for (auto &m : members) if (m.first == key) return m.second.get();
+    return nullptr;
+  }
+  JsonNode *addMember(const char *key) {
+    if (JsonNode *n = member(key)) return n;
+    members.emplace_back(key, std::unique_ptr<JsonNode>(new JsonNode));
+    return members.back().second.get();
+  }
+  JsonNode *addElement() {
+    elements.emplace_back(new JsonNode);
+    return elements.back().get();
+  }
+
+  void set(bool v) { reset(Bool); b = v; }
+  void set(const char *v) { if (v) { reset(String); s = v; } else reset(Null); }
+  void set(const std::string &v) { reset(String); s = v; }
+  template<class T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+  void set(T v) { reset(Int); i = (long long)v; }
+  template<class T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+  void set(T v) { reset(Float); f = v; }
+
+  // Conversions used by operator| and as<T>(): a default is returned when
+  // the stored type does not fit, like ArduinoJson does
+  bool get(bool &out) const { if (type != Bool) return false; out = b; return true; }
+  bool get(const char *&out) const { if (type != String) return false; out = s.c_str(); return true; }
+  template<class T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+  bool get(T &out) const {
+    if (type == Int) out = (T)i;
+    else if (type == Float) out = (T)f;
+    else return false;
+    return true;
+  }
+  template<class T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+  bool get(T &out) const {
+    if (type == Int) out = (T)i;
+    else if (type == Float) out = (T)f;
+    else return false;
+    return true;
+  }
+};
+
+class JsonObject;
+class JsonArray;
+
+// A value, or the place a member would be created at when assigned
+class JsonVariant {
+  public:
+    JsonVariant() {}
+    JsonVariant(JsonNode *node) : node_(node) {}
+    JsonVariant(JsonNode *parent, const char *key) : parent_(parent), key_(key ? key : "") {}
+
+    JsonNode *node() const { return node_ ? node_ : parent_ ? parent_->member(key_.c_str()) : nullptr; }
+    bool isNull() const { JsonNode *n = node(); return !n || n->type == JsonNode::Null; }
+    size_t size() const {
+      JsonNode *n = node();
+      if (!n) return 0;
+      return n->type == JsonNode::Array ? n->elements.size() : n->type == JsonNode::Object ? n->members.size() : 0;
+    }
+
+    template<class T> bool is() const { T v; JsonNode *n = node(); return n && n->get(v); }
+    template<class T> T as() const { T v = T(); JsonNode *n = node(); if (n) n->get(v); return v; }
+    template<class T> T operator|(T def) const { JsonNode *n = node(); if (n) n->get(def); return def; }
+
+    template<class T> JsonVariant &operator=(const T &value) { if (JsonNode *n = create()) n->set(value); return *this; }
+    JsonVariant &operator=(const char *value) { if (JsonNode *n = create()) n->set(value); return *this; }
+    JsonVariant &operator=(char *value) { return *this = (const char *)value; }
+
+    JsonVariant operator[](const char *key) const {
+      JsonNode *n = node();
+      return n && n->type == JsonNode::Object ? JsonVariant(n, key) : JsonVariant();
+    }
+    JsonVariant operator[](int index) const {
+      JsonNode *n = node();
+      if (!n || n->type != JsonNode::Array || index < 0 || (size_t)index >= n->elements.size()) return JsonVariant();
+      return JsonVariant(n->elements[index].get());
+    }
+
+    operator JsonObject() const;
+    operator JsonArray() const;
+
+  protected:
+    JsonNode *create() {
+      if (!node_ && parent_) node_ = parent_->addMember(key_.c_str());
+      return node_;
+    }
+
+    JsonNode *node_ = nullptr;
+    JsonNode *parent_ = nullptr;
+    std::string key_;
+};
+
+class JsonObject {
+  public:
+    JsonObject() {}
+    explicit JsonObject(JsonNode *node) : node_(node && node->type == JsonNode::Object ? node : nullptr) {}
+
+    bool isNull() const { return node_ == nullptr; }
+    size_t size() const { return node_ ? node_->members.size() : 0; }
+    JsonVariant operator[](const char *key) const { return node_ ? JsonVariant(node_, key) : JsonVariant(); }
+    JsonObject createNestedObject(const char *key) const {
+      if (!node_) return JsonObject();
+      JsonNode *n = node_->addMember(key);
+      n->reset(JsonNode::Object);
+      return JsonObject(n);
+    }
+    JsonArray createNestedArray(const char *key) const;
+    JsonNode *node() const { return node_; }
+
+  private:
+    JsonNode *node_ = nullptr;
+};
+
+class JsonArray {
+  public:
+    JsonArray() {}
+    explicit JsonArray(JsonNode *node) : node_(node && node->type == JsonNode::Array ? node : nullptr) {}
+
+    bool isNull() const { return node_ == nullptr; }
+    size_t size() const { return node_ ? node_->elements.size() : 0; }
+    JsonVariant operator[](int index) const { return JsonVariant(node_)[index]; }
+    template<class T> bool add(const T &value) const { if (!node_) return false; node_->addElement()->set(value); return true; }
+    bool add(const char *value) const { if (!node_) return false; node_->addElement()->set(value); return true; }
+    bool add(char *value) const { return add((const char *)value); }
+    JsonObject createNestedObject() const {
+      if (!node_) return JsonObject();
+      JsonNode *n = node_->addElement();
+      n->reset(JsonNode::Object);
+      return JsonObject(n);
+    }
+    JsonArray createNestedArray() const {
+      if (!node_) return JsonArray();
+      JsonNode *n = node_->addElement();
+      n->reset(JsonNode::Array);
+      return JsonArray(n);
+    }
+
+    class iterator {
+      public:
+        iterator(const std::unique_ptr<JsonNode> *p) : p_(p) {}
+        JsonVariant operator*() const { return JsonVariant(p_->get()); }
+        iterator &operator++() { ++p_; return *this; }
+        bool operator!=(const iterator &o) const { return p_ != o.p_; }
+      private:
+        const std::unique_ptr<JsonNode> *p_;
+    };
+    iterator begin() const { return iterator(node_ ? node_->elements.data() : nullptr); }
+    iterator end() const { return iterator(node_ ? node_->elements.data() + node_->elements.size() : nullptr); }
+
+  private:
+    JsonNode *node_ = nullptr;
+};
+
+inline JsonArray JsonObject::createNestedArray(const char *key) const {
+  if (!node_) return JsonArray();
+  JsonNode *n = node_->addMember(key);
+  n->reset(JsonNode::Array);
+  return JsonArray(n);
+}
+
+inline JsonVariant::operator JsonObject() const { return JsonObject(node()); }
+inline JsonVariant::operator JsonArray() const { return JsonArray(node()); }
+
+class DynamicJsonDocument {
+  public:
+    explicit DynamicJsonDocument(size_t /*capacity*/ = 0) { root_.reset(JsonNode::Object); }
+
+    void clear() { root_.reset(JsonNode::Object); }
+    JsonNode *node() { return &root_; }
+    JsonVariant operator[](const char *key) { return JsonVariant(&root_, key); }
+    template<class T> T as() { return T(&root_); }
+    template<class T> T to() { root_.reset(typeTag((T *)nullptr)); return T(&root_); }
+
+  private:
+    static JsonNode::Type typeTag(JsonObject *) { return JsonNode::Object; }
+    static JsonNode::Type typeTag(JsonArray *) { return JsonNode::Array; }
+    JsonNode root_;
+};
+
+// Parser for the JSON text used by the host scenarios, returns false on a syntax error
+class JsonParser {
+  public:
+    explicit JsonParser(const char *text) : p_(text) {}
+
+    bool parse(JsonNode &node) {
+      skip();
+      switch (*p_) {
+        case '{': {
+          node.reset(JsonNode::Object);
+          p_++; skip();
+          if (*p_ == '}') { p_++; return true; }
+          for (;;) {
+            std::string key;
+            skip();
+            if (!parseString(key)) return false;
+            skip();
+            if (*p_++ != ':') return false;
+            if (!parse(*node.addMember(key.c_str()))) return false;
+            skip();
+            if (*p_ == ',') { p_++; continue; }
+            if (*p_++ != '}') return false;
+            return true;
+          }
+        }
+        case '[': {
+          node.reset(JsonNode::Array);
+          p_++; skip();
+          if (*p_ == ']') { p_++; return true; }
+          for (;;) {
+            if (!parse(*node.addElement())) return false;
+            skip();
+            if (*p_ == ',') { p_++; continue; }
+            if (*p_++ != ']') return false;
+            return true;
+          }
+        }
+        case '"': {
+          std::string s;
+          if (!parseString(s)) return false;
+          node.set(s);
+          return true;
+        }
+        case 't': return literal("true") && (node.set(true), true);
+        case 'f': return literal("false") && (node.set(false), true);
+        case 'n': return literal("null") && (node.reset(JsonNode::Null), true);
+        default: {
+          char *end;
+          const char *start = p_;
+          long long i = strtoll(start, &end, 10);
+          if (end == start) return false;
+          if (*end == '.' || *end == 'e' || *end == 'E') {
+            node.set(strtod(start, &end));
+          } else {
+            node.set(i);
+          }
+          p_ = end;
+          return true;
+        }
+      }
+    }
+
+    bool atEnd() { skip(); return *p_ == 0; }
+
+  private:
+    void skip() { while (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t') p_++; }
+    bool literal(const char *word) {
+      size_t len = strlen(word);
+      if (strncmp(p_, word, len) != 0) return false;
+      p_ += len;
+      return true;
+    }
+    bool parseString(std::string &out) {
+      if (*p_++ != '"') return false;
+      while (*p_ && *p_ != '"') {
+        if (*p_ == '\\') {
+          p_++;
+          switch (*p_) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 0: return false;
+            default: out += *p_; break;  // \" \\ \/, no \u escapes
+          }
+          p_++;
+        } else {
+          out += *p_++;
+        }
+      }
+      if (*p_++ != '"') return false;
+      return true;
+    }
+
+    const char *p_;
+};
+
+struct DeserializationError {
+  bool failed;
+  explicit operator bool() const { return failed; }
+};
+
+inline DeserializationError deserializeJson(DynamicJsonDocument &doc, const char *text) {
+  JsonParser parser(text);
+  bool ok = parser.parse(*doc.node()) && parser.atEnd();
+  if (!ok) doc.clear();
+  return DeserializationError{!ok};
+}
+
+inline void serializeJsonNode(const JsonNode &n, std::string &out) {
+  char buf[32];
+  switch (n.type) {
+    case JsonNode::Null:   out += "null"; break;
+    case JsonNode::Bool:   out += n.b ? "true" : "false"; break;
+    case JsonNode::Int:    snprintf(buf, sizeof(buf), "%lld", n.i); out += buf; break;
+    case JsonNode::Float:  snprintf(buf, sizeof(buf), "%g", n.f); out += buf; break;
+    case JsonNode::String:
+      out += '"';
+      for (char c : n.s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+      }
+      out += '"';
+      break;
+    case JsonNode::Array:
+      out += '[';
+      for (size_t i = 0; i < n.elements.size(); i++) {
+        if (i) out += ',';
+        serializeJsonNode(*n.elements[i], out);
+      }
+      out += ']';
+      break;
+    case JsonNode::Object:
+      out += '{';
+      for (size_t i = 0; i < n.members.size(); i++) {
+        if (i) out += ',';
+        out += '"'; out += n.members[i].first; out += "\":";
+        serializeJsonNode(*n.members[i].second, out);
+      }
+      out += '}';
+      break;
+  }
+}
+
+inline std::string serializeJson(const JsonVariant &v) {
+  std::string out;
+  if (JsonNode *n = v.node()) serializeJsonNode(*n, out);
+  else out = "null";
+  return out;
+}
@@ -0,0 +1,129 @@
+/*
+ * Two staircases in one usermod, built with STAIRS_MAX_STAIRCASES=2: each
+ * has its own segment range, sensors, step delay and MQTT topics, the
+ * config round-trips through the flat keys of the settings page, and a
+ * walker on one staircase leaves the other one alone.
+ */
+#include "../usermod_stairs.h"
+#include "sim.h"
+
+static_assert(STAIRS_MAX_STAIRCASES >= 2, "build with STAIRS_MAX_STAIRCASES=2");
+
+static const uint8_t segments = 12;  // Segments 0-5 are the first staircase, 6-11 the second
+static const uint8_t switchPin = 13;
+static const uint8_t bottomPin[2] = {5, 7};
+static const unsigned long stepDelay[2] = {150, 100};
+static const unsigned long onTime = 10000;
+
+static const char config[] =
+  "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"staircases\":2,"
+  "\"segment-delay-ms\":150,\"on-time-s\":10,\"topPIRorTrigger_pin\":4,\"bottomPIRorTrigger_pin\":5,\"first-segment\":0,\"last-segment\":5,"
+  "\"segment-delay-ms-1\":100,\"on-time-s-1\":10,\"topPIRorTrigger_pin-1\":6,\"bottomPIRorTrigger_pin-1\":7,\"first-segment-1\":6,\"last-segment-1\":11}}";
+
+// Config as saved by addToConfig()
+static std::string saved(Animated_Staircase &um, DynamicJsonDocument &doc) {
+  doc.clear();
+  JsonObject root = doc.as<JsonObject>();
+  um.addToConfig(root);
+  return serializeJson(doc.as<JsonVariant>());
+}
+
+static unsigned litIn(uint8_t first, uint8_t last) {
+  unsigned lit = 0;
+  for (uint8_t id = first; id <= last; id++) lit += sim::segmentOn(id);
+  return lit;
+}
+
+static bool published(const std::string &topic) {
+  for (const sim::Message &m : sim::messages) {
+    if (m.topic == topic) return true;
+  }
+  return false;
+}
+
+int main() {
+  Animated_Staircase um;
+  sim::reset(segments);
+  sim::setPin(switchPin, HIGH);
+  sim::begin(um, config);
+  sim::run(um, onTime + 6 * stepDelay[0] + 1000);
+  CHECK(sim::litSegments() == 0);
+
+  // Swipe topics per staircase, the second one defaults to the suffix /1
+  bool swipe[2] = {false, false};
+  for (const std::string &s : sim::subscriptions) {
+    swipe[0] |= s == "wled/stairs/swipe";
+    swipe[1] |= s == "wled/stairs/swipe/1";
+  }
+  CHECK(swipe[0] && swipe[1]);
+
+  // Config round-trip: the first staircase at the top, the second with -1 keys
+  DynamicJsonDocument doc;
+  std::string text = saved(um, doc);
+  JsonVariant cfg = doc["staircase"];
+  CHECK((cfg["staircases"] | 0) == 2);
+  CHECK((cfg["segment-delay-ms"] | 0) == 150 && (cfg["segment-delay-ms-1"] | 0) == 100);
+  CHECK((cfg["bottomPIRorTrigger_pin-1"] | 0) == 7 && (cfg["first-segment-1"] | 0) == 6);
+  CHECK(strcmp(cfg["topic-suffix-1"] | "", "/1") == 0);
+  CHECK(cfg["staircases"].is<int>());  // No array, the settings page edits flat fields only
+  {
+    Animated_Staircase copy;
+    sim::reset(segments);
+    sim::setPin(switchPin, HIGH);
+    sim::begin(copy, text.c_str());
+    DynamicJsonDocument again;
+    CHECK(saved(copy, again) == text);
+  }
+  // A settings page post changes the second staircase only
+  CHECK(sim::configure(um, "{\"staircase\":{\"on-time-s-1\":20}}"));
+  saved(um, doc);
+  CHECK((doc["staircase"]["on-time-s"] | 0) == 10 && (doc["staircase"]["on-time-s-1"] | 0) == 20);
+  CHECK(sim::configure(um, "{\"staircase\":{\"on-time-s-1\":10}}"));
+
+  sim::reset(segments);
+  sim::setPin(switchPin, HIGH);
+  Animated_Staircase um2;
+  sim::begin(um2, config);
+  sim::run(um2, onTime + 6 * stepDelay[0] + 1000);
+  sim::resetStats();
+  sim::switches.clear();
+  sim::messages.clear();
+
+  // A walker on the second staircase lights segments 6-11 from the bottom
+  unsigned long t0 = sim::nowUs;
+  sim::setPin(bottomPin[1], HIGH);
+  sim::run(um2, 500);
+  sim::setPin(bottomPin[1], LOW);
+  sim::run(um2, 6 * stepDelay[1] + 500);
+  CHECK(litIn(6, 11) == 6 && litIn(0, 5) == 0);
+  CHECK(!sim::switches.empty() && sim::switches.front().segment == 11);
+  long first = sim::firstSwitch(t0, true);
+  long cascade = sim::lastSwitch(t0, true) - first;
+  CHECK(cascade >= (long)(5 * stepDelay[1] * 1000) && cascade <= (long)(5 * stepDelay[1] + 2) * 1000);
+  sim::run(um2, 500);
+  CHECK(published("wled/stairs/motion/1/1") && published("wled/stairs/staircase/1"));
+  CHECK(!published("wled/stairs/motion/1") && !published("wled/stairs/staircase"));
+  sim::report("second-staircase", first - t0, cascade);
+
+  // The first staircase starts its own cascade while the second is lit
+  sim::switches.clear();
+  t0 = sim::nowUs;
+  sim::setPin(bottomPin[0], HIGH);
+  sim::run(um2, 500);
+  sim::setPin(bottomPin[0], LOW);
+  sim::run(um2, 6 * stepDelay[0] + 500);
+  CHECK(litIn(0, 5) == 6 && litIn(6, 11) == 6);
+  first = sim::firstSwitch(t0, true);
+  cascade = sim::lastSwitch(t0, true) - first;
+  CHECK(cascade >= (long)(5 * stepDelay[0] * 1000) && cascade <= (long)(5 * stepDelay[0] + 2) * 1000);
+  for (const sim::Switch &s : sim::switches) CHECK(s.segment <= 5);
+  sim::report("first-staircase", first - t0, cascade);
+
+  // Each goes dark after its own on-time
+  sim::run(um2, onTime - 1500);
+  CHECK(litIn(6, 11) < 6 && litIn(0, 5) == 6);
+  sim::run(um2, 6 * stepDelay[0] + 3000);
+  CHECK(sim::litSegments() == 0);
+
+  return sim::failures ? 1 : 0;
+}
@@ -0,0 +1,301 @@
+/*
+ * Replays input traces downloaded from the JSON API ({"staircase":{"trace":true}})
+ * on the host and compares the resulting segment timeline.
+ *
+ *   replay                    record a synthetic session, replay it, check both agree
+ *   replay <file>...          replay trace files, check the timeline stored in them
+ *   replay --record <file>    write the synthetic session as a trace file
+ *
+ * A trace file holds the configuration of the recording controller (as in
+ * cfg.json), the trace object of the state response and, optionally, the
+ * expected timeline as [ms since the first record, segment, on] entries:
+ *
+ *   {"config": {"staircase": {...}}, "trace": {"base": ..., "data": [...]}, "timeline": [[0, 11, 1], ...]}
+ *
+ * The replay starts with the enable switch on and all sensors released,
+ * once the lights enabling holds on have gone out.
+ */
+#include "../usermod_stairs.h"
+#include "sim.h"
+#include <fstream>
+#include <sstream>
+
+static_assert(STAIRS_TRACE_BYTES > 0, "the replay driver needs the trace recorder");
+
+static const uint8_t steps = 12;
+
+// Timeline entry relative to the first input
+struct Step {
+  unsigned long ms;
+  uint8_t segment;
+  bool on;
+  bool operator==(const Step &o) const { return ms == o.ms && segment == o.segment && on == o.on; }
+};
+
+// Decoded trace record
+struct Record {
+  unsigned long ms;  // Since the first record
+  uint8_t kind;
+  uint8_t input;
+};
+
+// Pins and topics of one staircase, from the config
+struct FlightPins {
+  int trig[2];    // Indexed by end, UPPER = 1
+  int echo[2];
+  int maxDist[2];
+  std::string suffix;
+};
+
+static const char sessionConfig[] =
+  "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"trace-inputs\":true,\"segment-delay-ms\":150,\"on-time-s\":10,"
+  "\"topPIRorTrigger_pin\":4,\"bottomPIRorTrigger_pin\":5}}";
+
+static int hexDigit(char c) {
+  return c >= 'a' ? c - 'a' + 10 : c >= 'A' ? c - 'A' + 10 : c - '0';
+}
+
+// Decode the hex chunks of a trace object into records
+static std::vector<Record> decode(JsonVariant trace) {
+  std::vector<uint8_t> bytes;
+  for (JsonVariant chunk : (JsonArray)trace["data"]) {
+    const char *hex = chunk | "";
+    for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) bytes.push_back(hexDigit(hex[i]) << 4 | hexDigit(hex[i + 1]));
+  }
+  std::vector<Record> records;
+  unsigned long ms = 0;
+  for (size_t i = 0; i < bytes.size(); ) {
+    uint8_t code = bytes[i++];
+    unsigned long delta = 0;
+    for (uint8_t shift = 0; i < bytes.size(); shift += 7) {
+      uint8_t b = bytes[i++];
+      delta |= (unsigned long)(b & 0x7F) << shift;
+      if (!(b & 0x80)) break;
+    }
+    ms += delta;
+    records.push_back({ms, (uint8_t)(code >> 5), (uint8_t)(code & 0x1F)});
+  }
+  // The first delta is relative to base, only the spacing matters here
+  unsigned long first = records.empty() ? 0 : records.front().ms;
+  for (Record &r : records) r.ms -= first;
+  return records;
+}
+
+static std::vector<FlightPins> readPins(JsonVariant config) {
+  std::vector<FlightPins> flights;
+  JsonVariant cfg = config["staircase"];
+  int count = cfg["staircases"] | 1;
+  for (int i = 0; i < count; i++) {
+    // Staircases after the first add their index to the keys
+    std::string suffix = i ? "-" + std::to_string(i) : "";
+    auto key = [&](const char *name) { return std::string(name) + suffix; };
+    FlightPins f;
+    f.trig[1] = cfg[key("topPIRorTrigger_pin").c_str()] | -1;
+    f.trig[0] = cfg[key("bottomPIRorTrigger_pin").c_str()] | -1;
+    f.echo[1] = cfg[key("topEcho_pin").c_str()] | -1;
+    f.echo[0] = cfg[key("bottomEcho_pin").c_str()] | -1;
+    f.maxDist[1] = cfg[key("topMaxDist_cm").c_str()] | 50;
+    f.maxDist[0] = cfg[key("bottomMaxDist_cm").c_str()] | 50;
+    f.suffix = cfg[key("topic-suffix").c_str()] | "";
+    if (f.suffix.empty() && i > 0) f.suffix = "/" + std::to_string(i);
+    flights.push_back(f);
+  }
+  return flights;
+}
+
+// Start the usermod and wait until the lights enabling holds on are out
+static void start(Animated_Staircase &um, const char *config, int switchPin) {
+  sim::reset(steps);
+  if (switchPin >= 0) sim::setPin(switchPin, HIGH);
+  sim::begin(um, config);
+  sim::run(um, 15000);
+  sim::resetStats();
+  sim::switches.clear();
+  sim::messages.clear();
+}
+
+// Feed one record into the usermod the way it was recorded
+static void apply(Animated_Staircase &um, const Record &r, const std::vector<FlightPins> &flights, int switchPin, uint16_t udpPort) {
+  static uint32_t udpSeq = 0;
+  bool value = r.kind == 1 || r.kind == 3 || r.kind == 6;
+  uint8_t flight = r.input >> 1;
+  bool top = r.input & 1;
+  const char *sensorKey = top ? "top-sensor" : "bottom-sensor";
+  switch (r.kind) {
+    case 0: case 1:  // Raw level
+      if (r.input == 31) {
+        if (switchPin >= 0) sim::setPin(switchPin, value);
+      } else if (flight < flights.size()) {
+        const FlightPins &f = flights[flight];
+        if (f.echo[top] >= 0) sim::setDistance(f.trig[top], f.echo[top], value ? max(1, f.maxDist[top] / 2) : 0);  // In-range decision
+        else if (f.trig[top] >= 0) sim::setPin(f.trig[top], value);
+      }
+      break;
+    case 2: case 3: {  // JSON API override
+      std::string json;
+      if (r.input == 31) {
+        json = std::string("{\"staircase\":{\"enable-switch\":") + (value ? "true" : "false") + "}}";
+      } else if (flight == 0) {
+        json = std::string("{\"staircase\":{\"") + sensorKey + "\":" + (value ? "true" : "false") + "}}";
+      } else {
+        json = "{\"staircase\":{\"staircases\":[";
+        for (uint8_t i = 0; i < flight; i++) json += "{},";
+        json += std::string("{\"") + sensorKey + "\":" + (value ? "true" : "false") + "}]}}";
+      }
+      sim::request(um, json.c_str());
+      break;
+    }
+    case 4: {  // MQTT swipe
+      static const char *const commands[] = {"up", "down", "on", "off"};
+      uint8_t f = r.input / 4;
+      if (f >= flights.size()) break;
+      std::string topic = "/swipe" + flights[f].suffix;
+      std::vector<char> t(topic.begin(), topic.end());
+      t.push_back(0);
+      std::string payload = commands[r.input % 4];
+      std::vector<char> p(payload.begin(), payload.end());
+      p.push_back(0);
+      um.onMqttMessage(t.data(), p.data());
+      break;
+    }
+    case 5: case 6: {  // UDP datagram
+      uint32_t seq = ++udpSeq;
+      uint8_t packet[8] = {'S', 'T', r.input, (uint8_t)value, (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16), (uint8_t)(seq >> 24)};
+      if (udpPort) sim::sendUdp(udpPort, packet, sizeof(packet));
+      break;
+    }
+  }
+}
+
+// Replay the records and return the timeline, relative to the first record
+static std::vector<Step> replay(const char *config, const std::vector<Record> &records) {
+  DynamicJsonDocument doc;
+  deserializeJson(doc, config);
+  std::vector<FlightPins> flights = readPins(doc.as<JsonVariant>());
+  int switchPin = doc["staircase"]["enableSwitch_pin"] | -1;
+  uint16_t udpPort = doc["staircase"]["udp-port"] | 0;
+
+  Animated_Staircase um;
+  start(um, config, switchPin);
+  unsigned long t0 = sim::nowUs;
+  unsigned long elapsed = 0;
+  for (const Record &r : records) {
+    sim::run(um, r.ms - elapsed);
+    elapsed = r.ms;
+    apply(um, r, flights, switchPin, udpPort);
+  }
+  sim::run(um, 30000);  // Let the last cascades finish
+
+  std::vector<Step> timeline;
+  for (const sim::Switch &s : sim::switches) timeline.push_back({(s.us - t0) / 1000, s.segment, s.on});
+  return timeline;
+}
+
+// Synthetic session: walkers from both ends, a bouncing sensor, a glitch,
+// a JSON override and an MQTT swipe. Returns the trace file contents.
+static std::string record(std::vector<Step> &timeline) {
+  Animated_Staircase um;
+  start(um, sessionConfig, 13);
+  unsigned long t0 = 0;
+  auto walk = [&](uint8_t pin, unsigned long pulse, unsigned long after) {
+    if (!t0) t0 = sim::nowUs;
+    sim::setPin(pin, HIGH);
+    sim::run(um, pulse);
+    sim::setPin(pin, LOW);
+    sim::run(um, after);
+  };
+  walk(5, 900, 4000);
+  walk(4, 700, 15000);
+  walk(4, 600, 1200);
+  walk(5, 800, 16000);
+  for (int i = 0; i < 4; i++) walk(5, 35, 40);  // Bouncing
+  walk(5, 8, 15000);                           // Glitch
+  sim::request(um, "{\"staircase\":{\"top-sensor\":true}}");
+  sim::run(um, 15000);
+  char topic[] = "/swipe";
+  char payload[] = "up";
+  um.onMqttMessage(topic, payload);
+  sim::run(um, 30000);
+
+  timeline.clear();
+  for (const sim::Switch &s : sim::switches) {
+    if ((long)(s.us - t0) >= 0) timeline.push_back({(s.us - t0) / 1000, s.segment, s.on});
+  }
+
+  DynamicJsonDocument state;
+  sim::request(um, "{\"staircase\":{\"trace\":true}}");
+  sim::state(um, state);
+  DynamicJsonDocument config;
+  deserializeJson(config, sessionConfig);
+  std::string file = "{\"config\": " + serializeJson(config.as<JsonVariant>()) + ",\n";
+  file += " \"trace\": " + serializeJson(state["staircase"]["trace"]) + ",\n";
+  file += " \"timeline\": [";
+  for (size_t i = 0; i < timeline.size(); i++) {
+    file += i % 8 ? ", " : i ? ",\n  " : "\n  ";
+    file += "[" + std::to_string(timeline[i].ms) + ", " + std::to_string(timeline[i].segment) + ", " + (timeline[i].on ? "1" : "0") + "]";
+  }
+  file += "\n ]}\n";
+  return file;
+}
+
+static bool compare(const char *name, const std::vector<Step> &expected, const std::vector<Step> &actual) {
+  for (size_t i = 0; i < max(expected.size(), actual.size()); i++) {
+    if (i < expected.size() && i < actual.size() && expected[i] == actual[i]) continue;
+    printf("%s: timeline differs at switch %zu:", name, i);
+    if (i < expected.size()) printf(" expected %lu ms segment %u %s,", expected[i].ms, expected[i].segment, expected[i].on ? "on" : "off");
+    if (i < actual.size()) printf(" got %lu ms segment %u %s", actual[i].ms, actual[i].segment, actual[i].on ? "on" : "off");
+    printf("\n");
+    return false;
+  }
+  return true;
+}
+
+static int replayFile(const char *path) {
+  std::ifstream in(path);
+  std::stringstream text;
+  text << in.rdbuf();
+  DynamicJsonDocument doc;
+  if (!in || deserializeJson(doc, text.str().c_str())) {
+    printf("%s: cannot read the trace file\n", path);
+    return 1;
+  }
+  if ((doc["trace"]["dropped"] | 0) > 0) printf("%s: the oldest records were dropped, the replay starts mid-way\n", path);
+  std::string config = serializeJson(doc["config"]);
+  std::vector<Record> records = decode(doc["trace"]);
+  std::vector<Step> actual = replay(config.c_str(), records);
+  printf("%s: %zu records, %zu switches\n", path, records.size(), actual.size());
+  sim::report(path, -1, -1);
+
+  JsonArray stored = doc["timeline"];
+  if (stored.isNull()) return 0;  // Nothing to compare with, e.g. a fresh download
+  std::vector<Step> expected;
+  for (JsonVariant s : stored) expected.push_back({s[0] | 0UL, (uint8_t)(s[1] | 0), (s[2] | 0) != 0});
+  return compare(path, expected, actual) ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  if (argc == 3 && strcmp(argv[1], "--record") == 0) {
+    std::vector<Step> timeline;
+    std::ofstream(argv[2]) << record(timeline);
+    printf("%s: %zu switches recorded\n", argv[2], timeline.size());
+    return 0;
+  }
+  if (argc > 1) {
+    int failed = 0;
+    for (int i = 1; i < argc; i++) failed |= replayFile(argv[i]);
+    return failed;
+  }
+
+  // Record, then replay the trace from the JSON API on a fresh usermod
+  std::vector<Step> recorded;
+  std::string file = record(recorded);
+  DynamicJsonDocument doc;
+  CHECK(!deserializeJson(doc, file.c_str()));
+  std::vector<Record> records = decode(doc["trace"]);
+  std::vector<Step> replayed = replay(sessionConfig, records);
+  printf("session: %zu records, %zu switches\n", records.size(), recorded.size());
+  CHECK(records.size() > 10);
+  CHECK(compare("session", recorded, replayed));
+  sim::report("replay", -1, -1);
+  return sim::failures ? 1 : 0;
+}
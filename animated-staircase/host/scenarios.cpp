@@ -0,0 +1,342 @@
+/*
+ * Benchmark scenarios for Animated_Staircase with PIR sensors: prints the
+ * loop() cost, trigger-to-first-step latency, cascade duration and the
+ * strip.trigger()/colorUpdated() counts of each, and checks the cascades.
+ */
+#include "../usermod_stairs.h"
+#include "sim.h"
+
+static const uint8_t steps = 12;
+static const uint8_t topPin = 4;
+static const uint8_t bottomPin = 5;
+static const uint8_t switchPin = 13;         // Enable switch, held on
+static const unsigned long stepDelay = 150;  // segment-delay-ms below
+static const unsigned long onTime = 10000;   // on-time-s below
+
+static const char config[] =
+  "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"segment-delay-ms\":150,\"on-time-s\":10,"
+  "\"topPIRorTrigger_pin\":4,\"bottomPIRorTrigger_pin\":5}}";
+
+// Start the usermod with the enable switch on and let it settle: enabling
+// holds all steps lit for the on-time
+static void start(Animated_Staircase &um, const char *cfg = config) {
+  sim::reset(steps);
+  sim::setPin(switchPin, HIGH);
+  sim::begin(um, cfg);
+  sim::run(um, onTime + steps * stepDelay + 1000);
+  CHECK(sim::litSegments() == 0);
+  sim::resetStats();
+  sim::switches.clear();
+  sim::messages.clear();
+}
+
+// A walker triggers one sensor for 'pulse' ms, the stairs light up and
+// switch off again after the on-time
+static void walk(Animated_Staircase &um, const char *name, uint8_t pin, unsigned long pulse) {
+  unsigned long t0 = sim::nowUs;
+  sim::setPin(pin, HIGH);
+  sim::run(um, pulse);
+  sim::setPin(pin, LOW);
+  sim::run(um, steps * stepDelay + 500);
+  CHECK(sim::litSegments() == steps);
+
+  long first = sim::firstSwitch(t0, true);
+  long last = sim::lastSwitch(t0, true);
+  CHECK(first >= 0);
+  long cascade = last - first;
+  CHECK(cascade >= (long)((steps - 1) * stepDelay * 1000) && cascade <= (long)((steps - 1) * stepDelay * 1000 + 2000));
+  // The first step of the cascade is at the sensor end
+  CHECK(sim::switches.size() > 0 && sim::switches.front().segment == (pin == bottomPin ? steps - 1 : 0));
+
+  sim::run(um, onTime + steps * stepDelay + 1000);
+  CHECK(sim::litSegments() == 0);
+  sim::report(name, first - t0, cascade);
+}
+
+// Timed loop() passes so far, from the metrics in the JSON state
+static unsigned long passes(Animated_Staircase &um) {
+  DynamicJsonDocument doc;
+  sim::state(um, doc);
+  return doc["staircase"]["metrics"]["passes"] | 0UL;
+}
+
+// A pulse of 'ms' on a sensor pin
+static void pulse(Animated_Staircase &um, uint8_t pin, unsigned long ms) {
+  sim::setPin(pin, HIGH);
+  sim::run(um, ms);
+  sim::setPin(pin, LOW);
+}
+
+int main() {
+  // Single walker from the bottom and from the top
+  {
+    Animated_Staircase um;
+    start(um);
+    walk(um, "pir-bottom", bottomPin, 1000);
+    // One commit per switched step, both cascades
+    CHECK(sim::stats.colorUpdates == 2 * steps);
+    CHECK(sim::stats.triggers == sim::stats.colorUpdates);
+    sim::resetStats();
+    sim::switches.clear();
+    sim::messages.clear();
+    walk(um, "pir-top", topPin, 1000);
+  }
+
+  // A pulse shorter than min-pulse-ms is a glitch
+  {
+    Animated_Staircase um;
+    start(um);
+    sim::setPin(bottomPin, HIGH);
+    sim::run(um, 5);
+    sim::setPin(bottomPin, LOW);
+    sim::run(um, 3000);
+    CHECK(sim::switches.empty());
+    CHECK(sim::stats.colorUpdates == 0);
+    sim::report("pir-glitch", -1, -1);
+  }
+
+  // Two walkers from both ends, the stairs stay lit until the later one is gone
+  {
+    Animated_Staircase um;
+    start(um);
+    unsigned long t0 = sim::nowUs;
+    sim::setPin(bottomPin, HIGH);
+    sim::run(um, 500);
+    sim::setPin(bottomPin, LOW);
+    sim::run(um, 2000);
+    sim::setPin(topPin, HIGH);
+    sim::run(um, 500);
+    sim::setPin(topPin, LOW);
+    sim::run(um, onTime);
+    CHECK(sim::litSegments() == steps);  // The second walker's on-time has not expired yet
+    sim::run(um, 3000 + steps * stepDelay);
+    CHECK(sim::litSegments() == 0);
+    long first = sim::firstSwitch(t0, true);
+    sim::report("pir-two-walkers", first - t0, sim::lastSwitch(t0, true) - first);
+  }
+
+  // Nothing happens: loop() returns right away and the strip is left alone
+  {
+    Animated_Staircase um;
+    start(um);
+    sim::run(um, 60000);
+    CHECK(sim::stats.triggers == 0);
+    CHECK(sim::stats.colorUpdates == 0);
+    CHECK(sim::messages.empty());
+    sim::report("idle-60s", -1, -1);
+  }
+
+  // JSON API override and MQTT swipe start cascades too; sensor changes are
+  // published once per coalescing window
+  {
+    Animated_Staircase um;
+    start(um);
+    unsigned long t0 = sim::nowUs;
+    sim::request(um, "{\"staircase\":{\"bottom-sensor\":true}}");
+    sim::run(um, steps * stepDelay + 500);
+    CHECK(sim::litSegments() == steps);
+    sim::report("json-override", sim::firstSwitch(t0, true) - t0, -1);
+
+    sim::run(um, onTime + steps * stepDelay + 1000);
+    CHECK(sim::litSegments() == 0);
+    sim::resetStats();
+    sim::switches.clear();
+    sim::messages.clear();
+
+    t0 = sim::nowUs;
+    char topic[] = "/swipe";
+    char payload[] = "down";
+    CHECK(um.onMqttMessage(topic, payload));
+    sim::run(um, steps * stepDelay + 500);
+    CHECK(sim::litSegments() == steps);
+    CHECK(!sim::switches.empty() && sim::switches.front().segment == 0);  // Down starts at the top
+    long first = sim::firstSwitch(t0, true);
+    sim::report("mqtt-swipe", first - t0, sim::lastSwitch(t0, true) - first);
+
+    sim::run(um, onTime + steps * stepDelay + 1000);
+    sim::resetStats();
+    sim::messages.clear();
+    for (int i = 0; i < 5; i++) {  // A bouncing sensor
+      sim::setPin(bottomPin, HIGH);
+      sim::run(um, 30);
+      sim::setPin(bottomPin, LOW);
+      sim::run(um, 30);
+    }
+    sim::setPin(bottomPin, HIGH);
+    sim::run(um, 2000);
+    unsigned motion = 0, state = 0;
+    for (const sim::Message &m : sim::messages) {
+      if (m.topic == "wled/stairs/motion/1") motion++;
+      if (m.topic == "wled/stairs/staircase") state += m.retain;
+    }
+    CHECK(motion == 1);
+    CHECK(state >= 1);
+    sim::setPin(bottomPin, LOW);
+    sim::report("mqtt-bouncing-sensor", -1, -1);
+  }
+
+  // Single segment mode: 4 steps of 12 LEDs in one segment, faded per LED
+  // once per frame instead of switching segments
+  {
+    const uint8_t ledSteps = 4;
+    const uint16_t leds = 12;
+    Animated_Staircase um;
+    sim::reset(1, ledSteps * leds);
+    sim::setPin(switchPin, HIGH);
+    sim::begin(um, "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"single-segment\":true,\"led-steps\":4,\"metrics-in-state\":true,"
+                   "\"segment-delay-ms\":150,\"on-time-s\":10,\"topPIRorTrigger_pin\":4,\"bottomPIRorTrigger_pin\":5}}");
+    sim::run(um, onTime + ledSteps * stepDelay + 1000);
+    CHECK(sim::pixel(0) == 0 && sim::pixel(ledSteps * leds - 1) == 0);
+    unsigned long before = passes(um);
+    sim::resetStats();
+    sim::switches.clear();
+
+    // The bottom step fades in first, through intermediate levels
+    unsigned long t0 = sim::nowUs;
+    sim::setPin(bottomPin, HIGH);
+    bool partial = false;
+    long lit = -1;
+    for (int i = 0; i < 30; i++) {
+      sim::run(um, 10);
+      uint32_t c = sim::pixel(ledSteps * leds - 1);
+      partial |= c != 0 && c != 0xFFFFFF;
+      if (c == 0xFFFFFF && lit < 0) lit = sim::nowUs - t0;
+      CHECK(sim::pixel(0) == 0);  // The top step is not reached yet
+    }
+    sim::setPin(bottomPin, LOW);
+    CHECK(partial);
+    CHECK(lit >= 0 && lit <= (long)(20 + stepDelay + 20) * 1000);  // Debouncing, one step delay of fading, a frame
+    sim::run(um, ledSteps * stepDelay + 500);
+    for (uint16_t led = 0; led < ledSteps * leds; led++) CHECK(sim::pixel(led) == 0xFFFFFF);
+    CHECK(sim::switches.empty());  // The segment itself stays on
+    CHECK(sim::stats.colorUpdates == 0);
+    // One redraw per frame while a step is fading, not one per loop() pass
+    unsigned long frames = (ledSteps * stepDelay + stepDelay + 300) / 20;
+    CHECK(sim::stats.triggers <= frames);
+    CHECK(passes(um) - before <= frames + 20);
+    sim::report("single-segment-fade", lit, -1);
+
+    sim::run(um, onTime + ledSteps * stepDelay + 1000);
+    for (uint16_t led = 0; led < ledSteps * leds; led++) CHECK(sim::pixel(led) == 0);
+  }
+
+  // Polling fallback without interrupts: the pins are read every scan delay
+  // (100ms), loop() rests in between
+  {
+    Animated_Staircase um;
+    start(um, "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"use-interrupts\":false,\"metrics-in-state\":true,"
+              "\"segment-delay-ms\":150,\"on-time-s\":10,\"topPIRorTrigger_pin\":4,\"bottomPIRorTrigger_pin\":5}}");
+    unsigned long before = passes(um);
+    sim::run(um, 10000);
+    CHECK(passes(um) - before <= 10000 / 100 + 2);
+    unsigned long t0 = sim::nowUs;
+    pulse(um, bottomPin, 500);
+    sim::run(um, steps * stepDelay + 500);
+    CHECK(sim::litSegments() == steps);
+    long first = sim::firstSwitch(t0, true);
+    CHECK(first >= 0 && first - (long)t0 <= (100 + 20 + 100 + 2) * 1000);  // Up to two polls to qualify min-pulse-ms
+    CHECK(sim::switches.front().segment == steps - 1);
+    sim::run(um, onTime + steps * stepDelay + 1000);
+    CHECK(sim::litSegments() == 0);
+    sim::report("polling", first - t0, sim::lastSwitch(t0, true) - first);
+  }
+
+  // Adaptive timing: a walker from the bottom reaches the top after 2.8s,
+  // the next cascade from the bottom takes 2.8s / (12 steps + 2 lead steps)
+  // per step and the on-time shrinks to one and a half traversals
+  {
+    const unsigned long walkTime = 2800;
+    Animated_Staircase um;
+    start(um, "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"adaptive-timing\":true,\"min-step-ms\":50,\"max-step-ms\":500,\"lead-steps\":2,"
+              "\"segment-delay-ms\":150,\"on-time-s\":10,\"topPIRorTrigger_pin\":4,\"bottomPIRorTrigger_pin\":5}}");
+    pulse(um, bottomPin, 300);
+    sim::run(um, walkTime - 300);
+    pulse(um, topPin, 300);
+    DynamicJsonDocument doc;
+    sim::state(um, doc);
+    long up = doc["staircase"]["traversal-ms"][1] | 0L;
+    CHECK(up >= (long)walkTime - 5 && up <= (long)walkTime + 5);
+    sim::run(um, onTime + steps * stepDelay + 1000);
+    CHECK(sim::litSegments() == 0);
+    sim::switches.clear();
+
+    unsigned long t0 = sim::nowUs;
+    pulse(um, bottomPin, 300);
+    sim::run(um, walkTime);
+    CHECK(sim::litSegments() == steps);
+    long first = sim::firstSwitch(t0, true);
+    long cascade = sim::lastSwitch(t0, true) - first;
+    unsigned long learned = up / (steps + 2);
+    CHECK(cascade >= (long)((steps - 1) * learned - 5) * 1000 && cascade <= (long)((steps - 1) * learned + 5) * 1000);
+    // Nobody arrives at the top: dark after 1.5 traversals instead of 10s
+    sim::run(um, up + up / 2 + steps * learned + 500 - walkTime);
+    CHECK(sim::litSegments() == 0);
+    sim::report("adaptive-timing", first - t0, cascade);
+  }
+
+  // Settings changed mid-cascade: the running cascade keeps its step delay,
+  // the lit stairs take the new on-time and the next cascade the new delay
+  {
+    Animated_Staircase um;
+    start(um);
+    unsigned long t0 = sim::nowUs;
+    pulse(um, bottomPin, 300);
+    sim::run(um, 6 * stepDelay - 300);
+    CHECK(sim::configure(um, "{\"staircase\":{\"segment-delay-ms\":100,\"on-time-s\":5}}"));
+    sim::run(um, 6 * stepDelay + 500);
+    CHECK(sim::litSegments() == steps);
+    long first = sim::firstSwitch(t0, true);
+    long cascade = sim::lastSwitch(t0, true) - first;
+    CHECK(cascade >= (long)((steps - 1) * stepDelay) * 1000 && cascade <= (long)((steps - 1) * stepDelay + 2) * 1000);
+    bool ordered = sim::switches.size() == steps;
+    for (size_t i = 0; ordered && i < sim::switches.size(); i++) ordered = sim::switches[i].on && sim::switches[i].segment == steps - 1 - i;
+    CHECK(ordered);  // No step jumped, nothing was switched off or relit
+    // 5s after the walker left instead of 10s
+    sim::run(um, 5000 - 12 * stepDelay + 500);
+    CHECK(sim::litSegments() < steps);
+    sim::run(um, steps * stepDelay + 500);
+    CHECK(sim::litSegments() == 0);
+    sim::report("reconfigure-cascade", first - t0, cascade);
+
+    sim::switches.clear();
+    t0 = sim::nowUs;
+    pulse(um, topPin, 300);
+    sim::run(um, steps * 100 + 500);
+    cascade = sim::lastSwitch(t0, true) - sim::firstSwitch(t0, true);
+    CHECK(cascade >= (long)((steps - 1) * 100) * 1000 && cascade <= (long)((steps - 1) * 100 + 2) * 1000);
+  }
+
+  // Occupancy: with occupancy-off the stairs go dark as soon as the last
+  // walker has left at the other end, the on-time is only a safety timeout
+  {
+    Animated_Staircase um;
+    start(um, "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"occupancy-off\":true,"
+              "\"segment-delay-ms\":150,\"on-time-s\":10,\"topPIRorTrigger_pin\":4,\"bottomPIRorTrigger_pin\":5}}");
+    DynamicJsonDocument doc;
+    pulse(um, bottomPin, 300);
+    sim::run(um, 500);
+    pulse(um, bottomPin, 300);  // A second walker right behind
+    sim::state(um, doc);
+    CHECK((doc["staircase"]["occupancy"] | 0) == 2);
+    sim::run(um, 2000);
+    pulse(um, topPin, 300);  // The first one leaves
+    sim::run(um, 1000);
+    sim::state(um, doc);
+    CHECK((doc["staircase"]["occupancy"] | 0) == 1);
+    CHECK(sim::litSegments() == steps);  // Still somebody on the stairs
+    unsigned long t0 = sim::nowUs;
+    pulse(um, topPin, 300);  // The second one leaves
+    sim::run(um, 200 + 300 + 2 * steps * stepDelay);
+    sim::state(um, doc);
+    CHECK((doc["staircase"]["occupancy"] | 0) == 0);
+    CHECK(sim::litSegments() == 0);
+    // The off-cascades start once the top sensor is released (release-ms),
+    // long before the on-time. Each wavefront goes off from its own end, the
+    // first step goes dark where the cascades from both ends meet.
+    long off = sim::firstSwitch(t0, false);
+    CHECK(off >= 0 && off - (long)t0 <= (long)(300 + 200 + steps * stepDelay) * 1000);
+    sim::report("occupancy-off", -1, -1);
+  }
+
+  return sim::failures ? 1 : 0;
+}
@@ -0,0 +1,443 @@
+/*
+ * Simulated WLED for the host build: implements the stub API of wled.h on
+ * the virtual clock and the controls of sim.h.
+ */
+#include "sim.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sim {
+  unsigned long nowUs = 0;
+  static unsigned long loopIntervalUs = 1000;  // Time between two loop() calls
+  Stats stats;
+  std::vector<Switch> switches;
+  std::vector<Message> messages;
+  std::vector<std::string> subscriptions;
+  static bool networkUp = true;      // WLED_CONNECTED
+  static bool mqttConnected = true;  // WLED_MQTT_CONNECTED
+  int failures = 0;
+
+  static const uint8_t numPins = 64;
+  static const unsigned long frameUs = 20000;  // 50 frames per second
+
+  struct PinEvent {
+    unsigned long us;
+    uint8_t pin;
+    bool level;
+  };
+
+  static bool level[numPins];
+  static void (*isr[numPins])(void *);
+  static void *isrArg[numPins];
+  static bool allocated[numPins];
+  static int8_t echoPin[numPins];      // Indexed by trigger pin, -1 = no ultrasonic sensor
+  static uint16_t echoCm[numPins];
+  static std::vector<PinEvent> pending;
+
+  static Segment segments[WS2812FX::maxSegments];
+  static uint8_t numSegments = 0;
+  static std::vector<uint32_t> pixels;
+  static Usermod *active = nullptr;  // Receives onStateChange() from colorUpdated()
+  static unsigned long nextFrameUs = 0;
+
+  void reset(uint8_t count, uint16_t leds) {
+    nowUs = 1000000;
+    nextFrameUs = nowUs;
+    loopIntervalUs = 1000;
+    for (uint8_t i = 0; i < numPins; i++) {
+      level[i] = false;
+      isr[i] = nullptr;
+      isrArg[i] = nullptr;
+      allocated[i] = false;
+      echoPin[i] = -1;
+      echoCm[i] = 0;
+    }
+    pending.clear();
+    numSegments = min<uint8_t>(count, WS2812FX::maxSegments);
+    for (uint8_t i = 0; i < WS2812FX::maxSegments; i++) {
+      segments[i] = Segment();
+      if (i >= numSegments) continue;
+      segments[i].start = i * leds;
+      segments[i].stop = (i + 1) * leds;
+      segments[i].options = 1 << SEG_OPTION_ON;
+    }
+    pixels.assign(numSegments * leds, 0);
+    switches.clear();
+    messages.clear();
+    subscriptions.clear();
+    networkUp = true;
+    mqttConnected = true;
+    active = nullptr;
+    stateChanged = false;
+    offMode = false;
+    resetStats();
+  }
+
+  void resetStats() {
+    stats = Stats();
+  }
+
+  static bool parse(DynamicJsonDocument &doc, const char *json) {
+    if (deserializeJson(doc, json)) {
+      printf("invalid JSON: %s\n", json);
+      failures++;
+      return false;
+    }
+    return true;
+  }
+
+  bool begin(Usermod &um, const char *config) {
+    active = &um;
+    DynamicJsonDocument doc(4096);
+    if (!parse(doc, config)) return false;
+    JsonObject root = doc.as<JsonObject>();
+    um.readFromConfig(root);
+    um.setup();
+    if (networkUp) um.connected();
+#ifndef WLED_DISABLE_MQTT
+    if (mqttConnected) um.onMqttConnect(false);
+#endif
+    return true;
+  }
+
+  bool configure(Usermod &um, const char *config) {
+    DynamicJsonDocument doc(4096);
+    if (!parse(doc, config)) return false;
+    JsonObject root = doc.as<JsonObject>();
+    um.readFromConfig(root);
+    return true;
+  }
+
+  bool request(Usermod &um, const char *json) {
+    DynamicJsonDocument doc(4096);
+    if (!parse(doc, json)) return false;
+    JsonObject root = doc.as<JsonObject>();
+    um.readFromJsonState(root);
+    return true;
+  }
+
+  std::string state(Usermod &um, DynamicJsonDocument &doc) {
+    doc.clear();
+    JsonObject root = doc.as<JsonObject>();
+    um.addToJsonState(root);
+    return serializeJson(root["staircase"]);
+  }
+
+  void setPin(uint8_t pin, bool value) {
+    if (pin >= numPins || level[pin] == value) return;
+    level[pin] = value;
+    if (isr[pin]) isr[pin](isrArg[pin]);
+  }
+
+  // Drive a pin at a later time, used for the echo pulses
+  static void schedulePin(unsigned long us, uint8_t pin, bool value) {
+    pending.push_back({us, pin, value});
+  }
+
+  void setDistance(uint8_t trig, uint8_t echo, uint16_t cm) {
+    echoPin[trig] = echo;
+    echoCm[trig] = cm;
+  }
+
+  // Apply the pin events up to 'until' at their exact times
+  static void firePins(unsigned long until) {
+    for (;;) {
+      auto next = pending.end();
+      for (auto it = pending.begin(); it != pending.end(); ++it) {
+        if ((long)(it->us - until) <= 0 && (next == pending.end() || (long)(it->us - next->us) < 0)) next = it;
+      }
+      if (next == pending.end()) return;
+      PinEvent e = *next;
+      pending.erase(next);
+      if ((long)(e.us - nowUs) > 0) nowUs = e.us;
+      setPin(e.pin, e.level);
+    }
+  }
+
+  // Render one frame like WLED does: the effect (all LEDs of a segment that
+  // is on are white), then the usermod overlay
+  static void renderFrame(Usermod &um) {
+    for (uint8_t s = 0; s < numSegments; s++) {
+      for (uint16_t i = segments[s].start; i < segments[s].stop; i++) pixels[i] = segments[s].getOption(SEG_OPTION_ON) ? 0xFFFFFF : 0;
+    }
+    um.handleOverlayDraw();
+  }
+
+  void run(Usermod &um, unsigned long ms) {
+    active = &um;
+    unsigned long end = nowUs + ms * 1000;
+    while ((long)(nowUs - end) < 0) {
+      unsigned long next = min(end, nowUs + loopIntervalUs);
+      firePins(next);
+      nowUs = next;
+      auto started = std::chrono::steady_clock::now();
+      unsigned long startedUs = nowUs;
+      um.loop();
+      stats.loopMaxUs = max(stats.loopMaxUs, nowUs - startedUs);
+      unsigned long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+      stats.loops++;
+      stats.loopNs += ns;
+      stats.loopMaxNs = max(stats.loopMaxNs, ns);
+      if ((long)(nowUs - nextFrameUs) >= 0) {
+        nextFrameUs += frameUs;
+        renderFrame(um);
+      }
+    }
+  }
+
+  bool segmentOn(uint8_t id) {
+    return segments[id].getOption(SEG_OPTION_ON);
+  }
+
+  unsigned litSegments() {
+    unsigned lit = 0;
+    for (uint8_t i = 0; i < numSegments; i++) lit += segmentOn(i);
+    return lit;
+  }
+
+  long firstSwitch(unsigned long fromUs, bool on) {
+    for (const Switch &s : switches) {
+      if (s.on == on && (long)(s.us - fromUs) >= 0) return s.us;
+    }
+    return -1;
+  }
+
+  long lastSwitch(unsigned long fromUs, bool on) {
+    long last = -1;
+    for (const Switch &s : switches) {
+      if (s.on == on && (long)(s.us - fromUs) >= 0) last = s.us;
+    }
+    return last;
+  }
+
+  uint32_t pixel(uint16_t n) {
+    return n < pixels.size() ? pixels[n] : 0;
+  }
+
+  bool sendUdp(uint16_t port, const uint8_t *data, size_t len) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return false;
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool ok = sendto(fd, data, len, 0, (sockaddr *)&addr, sizeof(addr)) == (ssize_t)len;
+    close(fd);
+    return ok;
+  }
+
+  // Milliseconds with one decimal, "-" for a negative (not measured) time
+  static std::string formatMs(long us) {
+    char buf[16];
+    if (us < 0) return "-";
+    snprintf(buf, sizeof(buf), "%.1f", us / 1000.0);
+    return buf;
+  }
+
+  void report(const char *scenario, long latencyUs, long cascadeUs) {
+    printf("%-22s loop %4.0f ns avg %6lu ns max (%5lu calls)  latency %6s ms  cascade %7s ms  triggers %3lu  colorUpdated %3lu  publishes %3zu\n",
+           scenario, stats.loops ? (double)stats.loopNs / stats.loops : 0.0, stats.loopMaxNs, stats.loops,
+           formatMs(latencyUs).c_str(), formatMs(cascadeUs).c_str(), stats.triggers, stats.colorUpdates, messages.size());
+  }
+
+  bool check(bool ok, const char *what, const char *file, int line) {
+    if (!ok) {
+      printf("%s:%d: check failed: %s\n", file, line, what);
+      failures++;
+    }
+    return ok;
+  }
+}
+
+using namespace sim;
+
+/* Arduino core */
+
+unsigned long millis() { return nowUs / 1000; }
+unsigned long micros() { return nowUs; }
+void delayMicroseconds(unsigned int us) { nowUs += us; }
+
+int digitalRead(uint8_t pin) {
+  return pin < numPins && level[pin] ? HIGH : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin >= numPins) return;
+  bool falling = level[pin] && !value;
+  level[pin] = value;
+  // The end of a trigger pulse starts a ping, the echo pulse follows. Like
+  // the HC-SR04, a trigger is ignored while the echo pulse is still high.
+  if (falling && echoPin[pin] >= 0 && !level[echoPin[pin]]) {
+    unsigned long rise = nowUs + 50;
+    schedulePin(rise, echoPin[pin], true);
+    schedulePin(rise + (echoCm[pin] ? echoCm[pin] * 58UL : 38000UL), echoPin[pin], false);
+  }
+}
+
+void pinMode(uint8_t /*pin*/, uint8_t /*mode*/) {}
+
+void attachInterruptArg(uint8_t interrupt, void (*handler)(void *), void *arg, int /*mode*/) {
+  if (interrupt >= numPins) return;
+  isr[interrupt] = handler;
+  isrArg[interrupt] = arg;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+  if (interrupt < numPins) isr[interrupt] = nullptr;
+}
+
+/* Pin manager */
+
+PinManagerClass pinManager;
+
+bool PinManagerClass::allocatePin(byte gpio, bool /*output*/, PinOwner /*tag*/) {
+  if (gpio >= numPins || allocated[gpio]) return false;
+  allocated[gpio] = true;
+  return true;
+}
+
+bool PinManagerClass::allocateMultiplePins(const PinManagerPinType *pins, byte count, PinOwner /*tag*/) {
+  for (byte i = 0; i < count; i++) {
+    if (pins[i].pin < 0) continue;  // Unused slot
+    if (pins[i].pin >= numPins || allocated[pins[i].pin]) return false;
+  }
+  for (byte i = 0; i < count; i++) {
+    if (pins[i].pin >= 0) allocated[pins[i].pin] = true;
+  }
+  return true;
+}
+
+bool PinManagerClass::deallocatePin(byte gpio, PinOwner /*tag*/) {
+  if (gpio >= numPins || !allocated[gpio]) return false;
+  allocated[gpio] = false;
+  return true;
+}
+
+/* Strip */
+
+WS2812FX strip;
+
+void Segment::setOption(uint8_t n, bool value) {
+  if (getOption(n) == value) return;
+  options = value ? options | (1 << n) : options & ~(1 << n);
+  if (n == SEG_OPTION_ON) switches.push_back({nowUs, (uint8_t)(this - segments), value});
+}
+
+Segment &WS2812FX::getSegment(uint8_t id) {
+  return segments[id < maxSegments ? id : 0];
+}
+
+uint8_t WS2812FX::getMainSegmentId() { return 0; }
+
+uint8_t WS2812FX::getLastActiveSegmentId() {
+  for (uint8_t i = maxSegments; i > 0; i--) {
+    if (segments[i - 1].isActive()) return i - 1;
+  }
+  return 0;
+}
+
+uint8_t WS2812FX::getSegmentsNum() { return numSegments; }
+void WS2812FX::setTransition(uint16_t /*t*/) {}
+void WS2812FX::trigger() { stats.triggers++; }
+bool WS2812FX::isUpdating() { return false; }
+
+void WS2812FX::setPixelColor(int n, uint32_t c) {
+  if (n >= 0 && (size_t)n < pixels.size()) pixels[n] = c;
+}
+
+uint32_t WS2812FX::getPixelColor(uint16_t n) {
+  return sim::pixel(n);
+}
+
+uint32_t color_fade(uint32_t c1, uint8_t amount, bool /*video*/) {
+  uint32_t scale = amount + 1;
+  uint32_t rb = (((c1 & 0xFF00FF) * scale) >> 8) & 0xFF00FF;
+  uint32_t wg = (((c1 >> 8) & 0xFF00FF) * scale) & 0xFF00FF00;
+  return rb | wg;
+}
+
+/* Global state */
+
+bool stateChanged = false;
+bool offMode = false;
+byte bri = 128;
+uint16_t transitionDelay = 750;
+
+void colorUpdated(byte callMode) {
+  stats.colorUpdates++;
+  if (active) active->onStateChange(callMode);  // WLED notifies the usermods of every state change
+}
+
+void toggleOnOff() {
+  stats.toggles++;
+  offMode = !offMode;
+}
+
+bool simNetworkUp() { return networkUp; }
+
+/* MQTT sink */
+
+#ifndef WLED_DISABLE_MQTT
+static AsyncMqttClient mqttClient;
+AsyncMqttClient *mqtt = &mqttClient;
+char mqttDeviceTopic[33] = "wled/stairs";
+
+uint16_t AsyncMqttClient::publish(const char *topic, uint8_t /*qos*/, bool retain, const char *payload) {
+  messages.push_back({millis(), topic, payload, retain});
+  return messages.size();
+}
+
+uint16_t AsyncMqttClient::subscribe(const char *topic, uint8_t /*qos*/) {
+  subscriptions.push_back(topic);
+  return subscriptions.size();
+}
+
+bool AsyncMqttClient::connected() const { return mqttConnected; }
+#endif
+
+/* UDP */
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  stop();
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) return 0;
+  int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    stop();
+    return 0;
+  }
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  if (fd >= 0) close(fd);
+  fd = -1;
+  packetSize = 0;
+}
+
+int WiFiUDP::parsePacket() {
+  packetSize = 0;
+  if (fd < 0) return 0;
+  sim::stats.udpPolls++;
+  ssize_t len = recv(fd, packet, sizeof(packet), 0);
+  if (len > 0) packetSize = len;
+  return packetSize;
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t len) {
+  size_t n = min((size_t)packetSize, len);
+  memcpy(buffer, packet, n);
+  packetSize = 0;
+  return n;
+}
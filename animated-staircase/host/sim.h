@@ -0,0 +1,91 @@
+/*
+ * Controls of the simulated WLED around the usermod: a virtual clock, pins
+ * with interrupt dispatch and an ultrasonic echo model, a fake strip that
+ * logs every segment switch, an MQTT sink and the counters the scenarios
+ * report. The WLED side itself is declared in wled.h.
+ */
+#pragma once
+#include "wled.h"
+#include <string>
+#include <vector>
+
+namespace sim {
+
+  // Segment switch as logged by Segment::setOption(SEG_OPTION_ON, ...)
+  struct Switch {
+    unsigned long us;  // Virtual time of the switch
+    uint8_t segment;
+    bool on;
+  };
+
+  // MQTT publish received by the sink
+  struct Message {
+    unsigned long ms;
+    std::string topic;
+    std::string payload;
+    bool retain;
+  };
+
+  // Per scenario counters, cleared by resetStats()
+  struct Stats {
+    unsigned long loops = 0;         // loop() calls
+    unsigned long long loopNs = 0;   // Host CPU time spent in loop()
+    unsigned long loopMaxNs = 0;
+    unsigned long loopMaxUs = 0;     // Most virtual time one loop() call took (delayMicroseconds())
+    unsigned long triggers = 0;      // strip.trigger() calls
+    unsigned long colorUpdates = 0;  // colorUpdated() calls
+    unsigned long toggles = 0;       // toggleOnOff() calls
+    unsigned long udpPolls = 0;      // WiFiUDP::parsePacket() calls on a bound socket
+  };
+
+  extern unsigned long nowUs;             // Virtual clock, millis() is nowUs / 1000
+  extern Stats stats;
+  extern std::vector<Switch> switches;
+  extern std::vector<Message> messages;
+  extern std::vector<std::string> subscriptions;
+
+  // Start a new world: 'segments' segments of 'leds' LEDs each, all on,
+  // pins low and released, clock at one second, nothing logged
+  void reset(uint8_t segments, uint16_t leds = 10);
+  void resetStats();
+
+  // Configure the usermod from JSON like cfg.json ({"staircase": {...}}) and
+  // run setup() and connected(). Returns false if the JSON does not parse.
+  bool begin(Usermod &um, const char *config);
+  // Apply a settings change at runtime through readFromConfig()
+  bool configure(Usermod &um, const char *config);
+  // Send a state request through readFromJsonState(), like /json/state
+  bool request(Usermod &um, const char *state);
+  // JSON state as written by addToJsonState()
+  std::string state(Usermod &um, DynamicJsonDocument &doc);
+
+  // Drive a pin now, calling its interrupt handler
+  void setPin(uint8_t pin, bool level);
+  // Answer the pings of the ultrasonic sensor on trigger pin 'trig' with an
+  // echo on 'echo' for an object at 'cm' centimeters (0 = nothing in range)
+  void setDistance(uint8_t trig, uint8_t echo, uint16_t cm);
+
+  // Advance the clock by 'ms', calling loop() every millisecond and
+  // handleOverlayDraw() for every frame
+  void run(Usermod &um, unsigned long ms);
+
+  // Segment state and switch log
+  bool segmentOn(uint8_t id);
+  unsigned litSegments();
+  // Time of the first/last switch to 'on' at or after 'fromUs', -1 if none
+  long firstSwitch(unsigned long fromUs, bool on);
+  long lastSwitch(unsigned long fromUs, bool on);
+  uint32_t pixel(uint16_t n);
+
+  // Send a datagram to 127.0.0.1:port
+  bool sendUdp(uint16_t port, const uint8_t *data, size_t len);
+
+  // Print one line of scenario results, a negative time was not measured
+  void report(const char *scenario, long latencyUs, long cascadeUs);
+
+  // Test assertions, failures are counted and make main() return 1
+  extern int failures;
+  bool check(bool ok, const char *what, const char *file, int line);
+}
+
+#define CHECK(cond) sim::check((cond), #cond, __FILE__, __LINE__)
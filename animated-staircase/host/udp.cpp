@@ -0,0 +1,90 @@
+/*
+ * Remote sensors over UDP: datagrams are sent to the usermod over a real
+ * loopback socket. The socket has no interrupt, so loop() polls it every
+ * udpPollInterval and returns at the deadline check in between.
+ */
+#include "../usermod_stairs.h"
+#include "sim.h"
+
+static const uint8_t steps = 12;
+static const uint8_t switchPin = 13;
+static const uint16_t port = 47001;
+static const unsigned long stepDelay = 150;
+static const unsigned long onTime = 10000;
+static const unsigned long pollInterval = 20;  // udpPollInterval of the usermod
+
+static const char config[] =
+  "{\"staircase\":{\"enabled\":true,\"enableSwitch_pin\":13,\"udp-port\":47001,\"metrics-in-state\":true,"
+  "\"segment-delay-ms\":150,\"on-time-s\":10}}";
+
+// Datagram for a remote sensor, sensor = staircase * 2 + end (top = 1)
+static bool send(uint8_t sensor, bool level, uint32_t seq, size_t len = 8) {
+  uint8_t packet[8] = {'S', 'T', sensor, (uint8_t)level, (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16), (uint8_t)(seq >> 24)};
+  return sim::sendUdp(port, packet, len);
+}
+
+// Accepted and rejected datagrams from the metrics in the JSON state
+static void counters(Animated_Staircase &um, int &accepted, int &rejected) {
+  DynamicJsonDocument doc;
+  sim::state(um, doc);
+  accepted = doc["staircase"]["metrics"]["udp"] | -1;
+  rejected = doc["staircase"]["metrics"]["udp-rejected"] | -1;
+}
+
+int main() {
+  Animated_Staircase um;
+  sim::reset(steps);
+  sim::setPin(switchPin, HIGH);
+  sim::begin(um, config);
+  sim::run(um, onTime + steps * stepDelay + 1000);  // The lights enabling holds on go out
+  sim::resetStats();
+  sim::switches.clear();
+
+  // Idle: the socket is polled on its interval, not on every loop() call
+  sim::run(um, 1000);
+  CHECK(sim::stats.udpPolls >= 1000 / pollInterval - 1 && sim::stats.udpPolls <= 1000 / pollInterval + 1);
+  CHECK(sim::switches.empty());
+  sim::report("udp-idle", -1, -1);
+
+  // A remote bottom sensor starts the cascade within one poll interval
+  sim::resetStats();
+  unsigned long t0 = sim::nowUs;
+  CHECK(send(0, true, 1));
+  sim::run(um, 300);
+  CHECK(send(0, false, 2));
+  sim::run(um, steps * stepDelay);
+  CHECK(sim::litSegments() == steps);
+  long first = sim::firstSwitch(t0, true);
+  CHECK(first >= 0 && sim::switches.front().segment == steps - 1);
+  CHECK(first - (long)t0 <= (long)(pollInterval + 2) * 1000);
+  int accepted, rejected;
+  counters(um, accepted, rejected);
+  CHECK(accepted == 2 && rejected == 0);
+  sim::report("udp-bottom", first - t0, sim::lastSwitch(t0, true) - first);
+
+  // Duplicates, stale sequence numbers, malformed and unknown sensors are rejected
+  sim::run(um, onTime + steps * stepDelay + 1000);
+  CHECK(sim::litSegments() == 0);
+  sim::resetStats();
+  sim::switches.clear();
+  CHECK(send(0, false, 2));        // Duplicate
+  CHECK(send(0, true, 1));         // Reordered
+  CHECK(send(1, true, 5, 6));      // Truncated
+  CHECK(send(7, true, 1));         // No such staircase
+  sim::run(um, 2 * pollInterval);
+  counters(um, accepted, rejected);
+  CHECK(accepted == 2 && rejected == 4);
+  CHECK(sim::switches.empty());
+  sim::report("udp-rejected", -1, -1);
+
+  // A remote top sensor that is never released expires after the on-time
+  t0 = sim::nowUs;
+  CHECK(send(1, true, 1));
+  sim::run(um, steps * stepDelay + 100);
+  CHECK(sim::litSegments() == steps && sim::switches.front().segment == 0);
+  sim::run(um, 2 * onTime + steps * stepDelay + 1000);
+  CHECK(sim::litSegments() == 0);
+  sim::report("udp-expiry", sim::firstSwitch(t0, true) - t0, -1);
+
+  return sim::failures ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * Host stub of the WLED API used by usermod_stairs.h. It provides just
+ * enough of WLED and the Arduino core to compile the usermod unchanged on
+ * Linux; sim.cpp implements it on a virtual clock with a fake strip, fake
+ * pins, an MQTT sink and a loopback UDP socket (see sim.h for the controls).
+ */
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "json.h"
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+// Program memory is ordinary memory on the host
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define FPSTR(s) ((const char *)(s))
+#define SET_F(s) (s)
+#define IRAM_ATTR
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcat_P strcat
+#define strcpy_P strcpy
+
+#define DEBUG_PRINT(x)
+#define DEBUG_PRINTLN(x)
+
+// Arduino core
+#define INPUT         0x01
+#define OUTPUT        0x03
+#define INPUT_PULLUP  0x05
+#define LOW           0
+#define HIGH          1
+#define CHANGE        3
+#define NOT_AN_INTERRUPT -1
+
+unsigned long millis();
+unsigned long micros();
+void delayMicroseconds(unsigned int us);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void pinMode(uint8_t pin, uint8_t mode);
+inline int digitalPinToInterrupt(uint8_t pin) { return pin < 64 ? pin : NOT_AN_INTERRUPT; }
+void attachInterruptArg(uint8_t interrupt, void (*isr)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t interrupt);
+
+// glibc before 2.38 has no strlcpy
+inline size_t stairs_strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = 0;
+  }
+  return len;
+}
+#define strlcpy stairs_strlcpy
+
+// Pin manager
+enum struct PinOwner : uint8_t { None = 0, UM_AnimatedStaircase = 0x81 };
+struct PinManagerPinType {
+  int8_t pin;
+  bool isOutput;
+};
+class PinManagerClass {
+  public:
+    bool allocatePin(byte gpio, bool output, PinOwner tag);
+    bool allocateMultiplePins(const PinManagerPinType *pins, byte arrayElementSize, PinOwner tag);
+    bool deallocatePin(byte gpio, PinOwner tag);
+};
+extern PinManagerClass pinManager;
+
+// Strip and segments
+#define SEG_OPTION_SELECTED 0
+#define SEG_OPTION_ON       2
+#define CALL_MODE_DIRECT_CHANGE 1
+
+struct Segment {
+  uint16_t start = 0;
+  uint16_t stop = 0;  // One past the last LED, 0 means inactive
+  uint8_t options = 0;
+
+  bool isActive() const { return stop > start; }
+  uint16_t length() const { return stop - start; }
+  bool getOption(uint8_t n) const { return (options >> n) & 1; }
+  void setOption(uint8_t n, bool value);  // Switching SEG_OPTION_ON is recorded by the simulation
+};
+
+class WS2812FX {
+  public:
+    static constexpr uint8_t maxSegments = 32;
+    Segment &getSegment(uint8_t id);
+    uint8_t getMainSegmentId();
+    uint8_t getLastActiveSegmentId();
+    uint8_t getSegmentsNum();
+    uint8_t getMaxSegments() { return maxSegments; }
+    void setTransition(uint16_t t);
+    void trigger();
+    bool isUpdating();
+    void setPixelColor(int n, uint32_t c);
+    uint32_t getPixelColor(uint16_t n);
+};
+extern WS2812FX strip;
+
+uint32_t color_fade(uint32_t c1, uint8_t amount, bool video = false);
+
+// Global state
+extern bool stateChanged;
+extern bool offMode;
+extern byte bri;
+extern uint16_t transitionDelay;
+void colorUpdated(byte callMode);
+void toggleOnOff();
+bool simNetworkUp();
+#define WLED_CONNECTED (simNetworkUp())
+
+// MQTT, publishes and subscriptions end up in the sink
+#ifndef WLED_DISABLE_MQTT
+class AsyncMqttClient {
+  public:
+    uint16_t publish(const char *topic, uint8_t qos, bool retain, const char *payload);
+    uint16_t subscribe(const char *topic, uint8_t qos);
+    bool connected() const;
+};
+extern AsyncMqttClient *mqtt;
+extern char mqttDeviceTopic[33];
+#define WLED_MQTT_CONNECTED (mqtt != nullptr && mqtt->connected())
+#endif
+
+// UDP, a non-blocking socket on the loopback interface
+class WiFiUDP {
+  public:
+    uint8_t begin(uint16_t port);
+    void stop();
+    int parsePacket();
+    int read(uint8_t *buffer, size_t len);
+  private:
+    int fd = -1;
+    uint8_t packet[64];
+    int packetSize = 0;
+};
+
+#define USERMOD_ID_ANIMATED_STAIRCASE 11
+
+class Usermod {
+  public:
+    virtual ~Usermod() {}
+    virtual void setup() = 0;
+    virtual void connected() {}
+    virtual void loop() = 0;
+    virtual void handleOverlayDraw() {}
+    virtual void addToJsonInfo(JsonObject & /*obj*/) {}
+    virtual void addToJsonState(JsonObject & /*obj*/) {}
+    virtual void readFromJsonState(JsonObject & /*obj*/) {}
+    virtual void addToConfig(JsonObject & /*obj*/) {}
+    virtual bool readFromConfig(JsonObject & /*obj*/) { return true; }
+    virtual void appendConfigData() {}
+    virtual bool onMqttMessage(char * /*topic*/, char * /*payload*/) { return false; }
+    virtual void onMqttConnect(bool /*sessionPresent*/) {}
+    virtual void onStateChange(uint8_t /*mode*/) {}
+    virtual uint16_t getId() { return 0; }
+};
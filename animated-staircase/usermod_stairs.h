@@ -8,18 +8,105 @@
 #pragma once
 #include "wled.h"
 
-// Define the Animated_Staircase class which inherits from Usermod
-class Animated_Staircase : public Usermod {
+// Compile-time geometry of a staircase, see Staircase_Usermod
+#define STAIRS_END_TOP         1  // Sensor at the top end
+#define STAIRS_END_BOTTOM      2  // Sensor at the bottom end
+#define STAIRS_BOTH_ENDS       3
+#define STAIRS_SENSOR_PIR      1  // PIR or trigger inputs
+#define STAIRS_SENSOR_DISTANCE 2  // Ultrasonic distance sensors
+#define STAIRS_ANY_SENSOR      3
+
+// Number of staircases one usermod can drive, each takes up to 4 pins.
+// Raise it as a build flag for installations with several flights.
+#ifndef STAIRS_MAX_STAIRCASES
+  #define STAIRS_MAX_STAIRCASES 1
+#endif
+
+// Size of the input trace ring buffer (in bytes), 0 compiles the recorder out.
+// Set it as a build flag (e.g. 2048) on the controller that should record.
+#ifndef STAIRS_TRACE_BYTES
+  #define STAIRS_TRACE_BYTES 0
+#endif
+
+// Smallest integer type holding one bit per step
+template<bool Wide> struct Staircase_Mask { typedef uint64_t type; };
+template<> struct Staircase_Mask<false> { typedef uint32_t type; };
+
+// Strings and tables shared by all staircase variants, so they are only
+// stored once in flash however many variants are compiled in
+class Staircase_Common : public Usermod {
+  protected:
+    // Strings used multiple times in the code to save flash memory
+    static const char _name[];
+    static const char _enabled[];
+    static const char _segmentDelay[];
+    static const char _onTime[];
+    static const char _topPIRorTrigger_pin[];
+    static const char _bottomPIRorTrigger_pin[];
+    static const char _enableSwitch_pin[];
+    static const char _topEcho_pin[];
+    static const char _bottomEcho_pin[];
+    static const char _topMaxDist[];
+    static const char _bottomMaxDist[];
+    static const char _togglePower[];
+    static const char _useInterrupts[];
+    static const char _singleSegment[];
+    static const char _ledSteps[];
+    static const char _stepLeds[];
+    static const char _mqttCoalesce[];
+    static const char _compactState[];
+    static const char _minPulse[];
+    static const char _releaseHold[];
+    static const char _metricsInState[];
+    static const char _adaptiveTiming[];
+    static const char _minStep[];
+    static const char _maxStep[];
+    static const char _leadSteps[];
+    static const char _staircases[];
+    static const char _firstSegment[];
+    static const char _lastSegment[];
+    static const char _topicSuffix[];
+    static const char _traceInputs[];
+    static const char _udpPort[];
+    static const char _occupancyOff[];
+    static const char _infoButton[];
+    static const uint8_t _fadeLut[];
+};
+
+/*
+ * The staircase usermod. Steps, Ends and Sensors fix the geometry at compile
+ * time for dedicated installations: Steps > 0 caps the number of steps (1-64),
+ * which sizes the step tables and uses 32-bit step masks up to 32 steps; Ends
+ * and Sensors select which sensors exist, the code for the others is dropped.
+ * Animated_Staircase below is the runtime configured variant.
+ *
+ * One usermod drives up to STAIRS_MAX_STAIRCASES independent staircases
+ * (flights), each with its own sensors, segment range, timing and MQTT topics.
+ * The geometry template parameters apply to all of them.
+ */
+template<uint8_t Steps = 0, uint8_t Ends = STAIRS_BOTH_ENDS, uint8_t Sensors = STAIRS_ANY_SENSOR>
+class Staircase_Usermod : public Staircase_Common {
   private:
 
     /* Configuration variables (accessible via API and stored in flash memory) */
     bool enabled = false;                   // Enable or disable this usermod
-    unsigned long segment_delay_ms = 150;   // Delay between switching each segment of the staircase (in milliseconds)
-    unsigned long on_time_ms       = 10000; // Duration for which the staircase lights stay on (in milliseconds)
-    int8_t topPIRorTriggerPin      = -1;    // Pin for the top PIR sensor or trigger, -1 means disabled
-    int8_t bottomPIRorTriggerPin   = -1;    // Pin for the bottom PIR sensor or trigger, -1 means disabled
     int8_t enableSwitchPin         = -1;    // Pin for the hardware switch to enable/disable the usermod, -1 means disabled
     bool togglePower               = false; // Toggle power on/off with the staircase lights
+    bool useInterrupts             = true;  // Capture sensor edges with pin-change interrupts where possible
+    bool singleSegment             = false; // Render the steps of the first staircase inside its first segment instead of one segment per step
+    uint8_t ledSteps               = 16;    // Number of steps in single segment mode
+    unsigned long mqtt_coalesce_ms = 200;   // Window in which MQTT changes are collected before publishing (in milliseconds)
+    bool compactState              = false; // Only expose the packed status in the JSON state
+    unsigned int min_pulse_ms      = 20;    // Minimum time an input has to be active before it counts (in milliseconds)
+    unsigned int release_ms        = 200;   // Time an input has to be inactive before it is released (in milliseconds)
+    bool metricsInState            = false; // Also expose the runtime metrics in the JSON state
+    bool adaptiveTiming            = false; // Learn the step delay and on-time from the measured walking speed
+    unsigned long min_step_ms      = 50;    // Lower bound of the learned step delay (in milliseconds)
+    unsigned long max_step_ms      = 500;   // Upper bound of the learned step delay (in milliseconds)
+    uint8_t leadSteps              = 2;     // Steps the light stays ahead of the walker with adaptive timing
+    bool traceInputs               = false; // Record the inputs in the trace ring buffer
+    uint16_t udpPort               = 0;     // UDP port for remote sensor datagrams, 0 means disabled
+    bool occupancyOff              = false; // Switch off as soon as the occupancy count drops to zero
 
     /* Runtime variables */
     bool initDone = false;
@@ -27,287 +114,1595 @@ class Animated_Staircase : public Usermod {
     // Constant delay for sensor checking (in milliseconds)
     const unsigned int scanDelay = 100;
 
-    // Lights on or off.
-    // Flipping this will start a transition.
-    bool on = false;
+    // Animation state machine of a wavefront.
+    // Segments are only stepped while a cascade is running; once it has
+    // finished the usermod is quiescent until the next sensor or timeout event.
+    enum StairsState : uint8_t {
+      STAIRS_OFF,            // All steps off, wavefront slot is free
+      STAIRS_SWITCHING_ON,   // On-cascade running
+      STAIRS_ON,             // All steps lit, waiting for the power-off timeout
+      STAIRS_SWITCHING_OFF   // Off-cascade running
+    };
 
     // Tracks the last sensor activated to determine the direction of movement
     #define LOWER false
     #define UPPER true
-    bool lastSensor = LOWER; // Last activated sensor
-    bool swipe = LOWER;      // Direction of swipe (UPPER or LOWER)
 
-    // Timestamp of the last transition action (in milliseconds)
-    unsigned long lastTime = 0;
+    // One wavefront per person on the stairs. The on-cascade grows from the
+    // end where the person entered, one step per stepDelay, and once the
+    // on-time has expired the off-cascade follows it from the same end.
+    // Positions are derived from the start times, so fronts never need to be
+    // moved and the lit mask is simply the union of all fronts.
+    struct Wavefront {
+      unsigned long onStart;   // Time the on-cascade started (in milliseconds)
+      unsigned long offStart;  // Time the off-cascade started (in milliseconds)
+      unsigned long lastSeen;  // Last sensor change at the entry end (in milliseconds)
+      unsigned long stepDelay; // Delay between two steps of this wavefront (in milliseconds)
+      unsigned long onTime;    // Quiet time at the entry end before switching off (in milliseconds)
+      bool fromTop;            // Entered at the top sensor (UPPER) or the bottom sensor (LOWER)
+      bool arrived;            // The walker has reached the sensor at the other end
+      StairsState state;       // STAIRS_OFF marks a free slot
+    };
+    static const uint8_t maxWavefronts = 4;
+    static const uint8_t maxEntries = 8;  // Walkers counted per end
 
-    // Timestamp of the last sensor check (in milliseconds)
-    unsigned long lastScanTime = 0;
+    // Debounce filter per input (bottom, top, enable switch). A raw level only
+    // becomes the filtered level after it has been stable for min_pulse_ms
+    // (active) or release_ms (inactive); shorter excursions are counted as glitches.
+    struct InputFilter {
+      unsigned long rawSince;  // Time of the last raw level change (in milliseconds)
+      bool raw;                // Last raw level
+      bool stable;             // Filtered level
+      uint16_t glitches;       // Rejected pulses and dropouts
+    };
 
-    // Timestamp of the last light switch action (in milliseconds)
-    unsigned long lastSwitchTime = 0;
+    // Step state of a staircase as bitmasks, bit 0 is the top step (stepSegment[0]).
+    // Each tick the wavefronts are combined into the desired mask and only the
+    // bits that differ from the applied mask are written to the strip.
+    static_assert(Steps <= 64, "Steps must be 0 (runtime count) to 64");
+    static const uint8_t maxSteps = Steps ? Steps : 64;
+    typedef typename Staircase_Mask<(maxSteps > 32)>::type StepMask;
+    static const uint8_t maskBits = sizeof(StepMask) * 8;
 
-    // Indices for controlling the segments (light sections) of the staircase
-    int8_t topIndex = 0;       // Index for the top of the staircase
-    int8_t bottomIndex = 0;    // Index for the bottom of the staircase
-    int8_t disableIndex = 0;   // Index for disabling segments
+    // Runtime metrics, always compiled in. Only loop() passes that do work are
+    // timed, the early return before the deadline costs nothing extra.
+    static const uint8_t loopBuckets = 8;
+    struct Metrics {
+      uint32_t loopMin = UINT32_MAX;        // Shortest loop() pass (in microseconds)
+      uint32_t loopAvg16 = 0;               // Moving average of the loop() passes, times 16 (in microseconds)
+      uint32_t loopMax = 0;                 // Longest loop() pass (in microseconds)
+      uint32_t loopPasses = 0;              // Timed loop() passes
+      uint16_t loopHist[loopBuckets] = {};  // Passes < 32, 64, 128, ... 2048 and >= 2048 microseconds
+      unsigned long latencyLast = 0;        // Sensor edge to first step lit (in milliseconds)
+      unsigned long latencyMax = 0;
+      unsigned long cascadeLast = 0;        // Duration of the last full on-cascade (in milliseconds)
+      unsigned long cascadeMax = 0;
+      uint32_t triggers = 0;                // strip.trigger() calls
+      uint32_t publishes = 0;               // MQTT publishes
+      uint32_t edges = 0;                   // Sensor state changes after debouncing
+      uint32_t toggles = 0;                 // Power toggles
+      uint32_t udpAccepted = 0;             // Remote sensor datagrams applied
+      uint32_t udpRejected = 0;             // Malformed, unknown, duplicate or stale datagrams
+    };
 
-    // Maximum and minimum segment IDs for the configured staircase
-    byte maxSegmentId = 1;
-    byte minSegmentId = 0;
+    // Sensors are numbered flight * 2 + end (UPPER/LOWER) in the interrupt
+    // tables, the edge queue and the ping rotation
+    static const uint8_t maxFlights = STAIRS_MAX_STAIRCASES;
+    static const uint8_t maxSensors = 2 * maxFlights;
+    static_assert(maxFlights >= 1 && maxFlights <= 8, "STAIRS_MAX_STAIRCASES must be 1 to 8");
 
-    // Variables to store the state of sensors and switches, used by the API
-    bool topSensorRead     = false;
-    bool topSensorWrite    = false;
-    bool bottomSensorRead  = false;
-    bool bottomSensorWrite = false;
-    bool enableSwitchRead  = false;
-    bool enableSwitchWrite = false;
-    bool topSensorState    = false;
-    bool bottomSensorState = false;
-    bool enableSwitchState = false;
+    // Input trace: every input is recorded as it enters the usermod, one
+    // code byte (kind in bits 5-7, input in bits 0-4) followed by the time
+    // since the previous record as a little-endian base-128 varint (in
+    // milliseconds). Most records take 2 or 3 bytes.
+    enum TraceKind : uint8_t {
+      TRACE_LOW,       // Raw level of a sensor or the enable switch went low
+      TRACE_HIGH,      // Raw level went high
+      TRACE_JSON_OFF,  // JSON API override with false
+      TRACE_JSON_ON,   // JSON API override with true
+      TRACE_MQTT,      // MQTT message, input is flight * 4 + up/down/on/off
+      TRACE_UDP_LOW,   // UDP datagram releasing a remote sensor
+      TRACE_UDP_HIGH   // UDP datagram activating a remote sensor
+    };
+    static const uint8_t traceEnableSwitch = 31;  // Input number of the enable switch
+    static_assert(STAIRS_TRACE_BYTES == 0 || (STAIRS_TRACE_BYTES >= 16 && STAIRS_TRACE_BYTES <= 32768), "STAIRS_TRACE_BYTES must be 0 or 16 to 32768");
+    static const uint16_t traceBytes = STAIRS_TRACE_BYTES ? STAIRS_TRACE_BYTES : 1;
 
-    // Strings used multiple times in the code to save flash memory
-    static const char _name[];
-    static const char _enabled[];
-    static const char _segmentDelay[];
-    static const char _onTime[];
-    static const char _topPIRorTrigger_pin[];
-    static const char _bottomPIRorTrigger_pin[];
-    static const char _enableSwitch_pin[];
-    static const char _togglePower[];
+    // One staircase (flight) with its own sensors, segment range, timing,
+    // wavefronts and MQTT topics. The settings shared by all flights, the
+    // metrics and the scheduler stay in the usermod, reached through 'um'.
+    struct Flight {
+      Staircase_Usermod *um = nullptr;  // Owning usermod
+      uint8_t index = 0;                // Position in the flights array
+
+      /* Configuration */
+      unsigned long segment_delay_ms = 150;   // Delay between switching each segment of the staircase (in milliseconds)
+      unsigned long on_time_ms       = 10000; // Duration for which the staircase lights stay on (in milliseconds)
+      int8_t topPIRorTriggerPin      = -1;    // Pin for the top PIR sensor or trigger, -1 means disabled
+      int8_t bottomPIRorTriggerPin   = -1;    // Pin for the bottom PIR sensor or trigger, -1 means disabled
+      int8_t topEchoPin              = -1;    // Echo pin of an ultrasonic sensor at the top (trigger on topPIRorTriggerPin), -1 means PIR
+      int8_t bottomEchoPin           = -1;    // Echo pin of an ultrasonic sensor at the bottom (trigger on bottomPIRorTriggerPin), -1 means PIR
+      unsigned int topMaxDist_cm     = 50;    // Objects closer to the top ultrasonic sensor count as motion (in centimeters)
+      unsigned int bottomMaxDist_cm  = 50;    // Objects closer to the bottom ultrasonic sensor count as motion (in centimeters)
+      int8_t firstSegment            = -1;    // Segment of the top step, -1 means the main segment
+      int8_t lastSegment             = -1;    // Segment of the bottom step, -1 means the last active segment
+      char topicSuffix[16]           = "";    // Appended to the MQTT topics of this staircase, e.g. "/cellar"
+
+      /* Runtime */
+      bool lastSensor = LOWER;                // Last activated sensor
+      Wavefront fronts[maxWavefronts] = {};
+
+      // Adaptive timing: walking time between the two sensors per direction as an
+      // exponentially weighted moving average (weight 1/4), times 16.
+      uint32_t traversal16[2] = {0, 0};  // Indexed by the entry sensor (UPPER = walking down), 0 = no sample yet
+
+      // Occupancy: entry times of the walkers on the stairs per entry end,
+      // oldest first. An activation at one end pairs with the oldest entry
+      // from the other end within the traversal window as an exit, any
+      // other activation is an entry.
+      unsigned long entryTime[2][maxEntries];
+      uint8_t entries[2] = {0, 0};      // Indexed by the entry sensor
+      bool emptied = false;             // The last walker has left, switch off once the sensors release
 
-    // Function to publish sensor states to MQTT
-    void publishMqtt(bool bottom, const char* state) {
+      StepMask desiredMask = 0;   // Steps that should be lit
+      StepMask appliedMask = 0;   // Steps as last written to the strip
+
+      // Cached list of the active segments of the staircase, one per step.
+      // Rebuilt only when the segment layout changes or a preset is applied.
+      uint8_t stepSegment[maxSteps];
+      uint8_t numSteps = 0;
+
+      // Variables to store the state of the sensors, used by the API
+      bool topSensorRead     = false;
+      bool topSensorWrite    = false;
+      bool bottomSensorRead  = false;
+      bool bottomSensorWrite = false;
+      bool topSensorState    = false;
+      bool bottomSensorState = false;
+
+      InputFilter filters[2] = {};            // Debounce filters, indexed by UPPER/LOWER
+      bool sensorLevel[2] = {false, false};   // Last pin level seen through the edge queue
+      bool inRange[2] = {false, false};       // Last ultrasonic measurement was within the distance threshold
+      uint16_t distance[2] = {0, 0};          // Last measured distance (in centimeters), 0 means nothing in range
+      unsigned long latencyStart = 0;         // Pin edge of a wavefront waiting for its first step
+      bool latencyPending = false;
+
+      // Remote sensors reported over UDP, ORed into the sensor states like
+      // the API overrides but held until released. A remote sensor that is
+      // never released expires after on_time_ms.
+      bool remoteLevel[2] = {false, false};   // Indexed by UPPER/LOWER
+      bool remoteSeen[2] = {false, false};    // A datagram has been accepted, remoteSeq is valid
+      uint32_t remoteSeq[2] = {0, 0};         // Sequence number of the last accepted datagram
+      unsigned long remoteSince[2] = {0, 0};  // Time of the last accepted datagram (in milliseconds)
+
+      // MQTT publishing is coalesced: the first change opens a window of
+      // mqtt_coalesce_ms and only the final state is published when it closes,
+      // so bouncing sensors do not flood the broker.
+      bool mqttPending = false;               // Changes are waiting to be published
+      unsigned long mqttPendingSince = 0;     // Time the coalescing window opened (in milliseconds)
 #ifndef WLED_DISABLE_MQTT
-      // Check if MQTT is connected to prevent crashing
-      if (WLED_MQTT_CONNECTED){
-        char subuf[64];
-        // Format the topic string for publishing
-        sprintf_P(subuf, PSTR("%s/motion/%d"), mqttDeviceTopic, (int)bottom);
-        mqtt->publish(subuf, 0, false, state);  // Publish the sensor state to MQTT
-      }
+      // Topics are built in onMqttConnect(), empty until then
+      char motionTopic[2][64] = {"", ""};     // <deviceTopic>/motion<suffix>/0 (top) and /1 (bottom)
+      char stateTopic[64] = "";               // <deviceTopic>/staircase<suffix>, retained aggregate state
+      bool publishedMotion[2] = {false, false};  // Last published motion, indexed like motionTopic
+      bool statePublished = false;            // The retained state below has been published
+      bool publishedOn = false;               // Last published aggregate state
+      bool publishedDir = false;
+      StepMask publishedLit = 0;
+      uint8_t publishedOccupancy = 0;
 #endif
-    }
 
-    // Function to update the staircase light segments based on sensor input
-    void updateSegments() {
-      // Update segments from the top of the staircase
-      if (topIndex < maxSegmentId && topIndex >= minSegmentId) {
-          strip.getSegment(topIndex).setOption(SEG_OPTION_ON, true);
-          topIndex++;
+      // Interrupt and ping number of a sensor of this flight
+      uint8_t sensorIndex(bool end) const {
+        return index * 2 + end;
+      }
+
+      // Pins of an end, -1 if the end is not compiled in
+      int8_t triggerPin(uint8_t sensor) const {
+        if (!(Ends & (sensor == UPPER ? STAIRS_END_TOP : STAIRS_END_BOTTOM))) return -1;
+        return sensor == UPPER ? topPIRorTriggerPin : bottomPIRorTriggerPin;
+      }
+      int8_t echoPin(uint8_t sensor) const {
+        if (!(Sensors & STAIRS_SENSOR_DISTANCE)) return -1;
+        return sensor == UPPER ? topEchoPin : bottomEchoPin;
       }
 
-      // Update segments from the bottom of the staircase
-      if (bottomIndex >= minSegmentId && bottomIndex < maxSegmentId) {
-          strip.getSegment(bottomIndex).setOption(SEG_OPTION_ON, true);
-          bottomIndex--;
+      // An end with an echo pin is an ultrasonic sensor instead of a PIR
+      bool distanceSensor(uint8_t sensor) const {
+        return echoPin(sensor) >= 0 && triggerPin(sensor) >= 0;
+      }
+      bool pirSensor(uint8_t sensor) const {
+        return (Sensors & STAIRS_SENSOR_PIR) && triggerPin(sensor) >= 0 && !distanceSensor(sensor);
       }
 
-      // If a swipe is detected, disable segments accordingly
-      if (swipe) {
-        if (disableIndex >= bottomIndex && bottomIndex != -1) {
-          disableIndex = maxSegmentId;
+      // Function to standardize invalid pin numbers to -1 and to release the
+      // pins of ends and sensor types that are not compiled in
+      void normalizePins() {
+        if (topPIRorTriggerPin    < 0) topPIRorTriggerPin    = -1;
+        if (bottomPIRorTriggerPin < 0) bottomPIRorTriggerPin = -1;
+        if (topEchoPin    < 0) topEchoPin    = -1;
+        if (bottomEchoPin < 0) bottomEchoPin = -1;
+        if (!(Ends & STAIRS_END_TOP))    topPIRorTriggerPin = topEchoPin = -1;
+        if (!(Ends & STAIRS_END_BOTTOM)) bottomPIRorTriggerPin = bottomEchoPin = -1;
+        if (!(Sensors & STAIRS_SENSOR_DISTANCE)) topEchoPin = bottomEchoPin = -1;
+      }
+
+      // Function to configure the sensor pins, trigger pins of distance sensors are outputs
+      void configurePins() {
+        for (uint8_t i = 0; i < 2; i++) {
+          if (distanceSensor(i)) {
+            pinMode(triggerPin(i), OUTPUT);
+            digitalWrite(triggerPin(i), LOW);
+            pinMode(echoPin(i), INPUT);
+          } else {
+            pinMode(triggerPin(i), INPUT);
+          }
         }
-        if (disableIndex < maxSegmentId && disableIndex >= 0) {
-          strip.getSegment(disableIndex).setOption(SEG_OPTION_ON, false);
-          disableIndex++;
+      }
+
+      // Read a sensor, using the interrupt-tracked level when the pin has an ISR
+      bool readSensorPin(uint8_t sensor) {
+        if (distanceSensor(sensor)) return inRange[sensor];  // Trigger pin, the level comes from the echo
+        if (!pirSensor(sensor)) return false;
+        if (isrPin[sensorIndex(sensor)] >= 0) return sensorLevel[sensor];
+        return digitalRead(triggerPin(sensor));
+      }
+
+      // Render steps through the fade overlay instead of switching segments.
+      // Only the first staircase can use single segment mode.
+      bool fadesSteps() const {
+        return um->singleSegment && index == 0;
+      }
+
+      // Function to rebuild the cached step list from the current segment layout
+      void refreshSegments() {
+        uint8_t first = firstSegment < 0 ? strip.getMainSegmentId() : firstSegment;
+        uint8_t last  = lastSegment  < 0 ? strip.getLastActiveSegmentId() : lastSegment;
+        if (fadesSteps()) {
+          um->refreshStepMap(*this, first);
+          return;
         }
-      } else {
-        if (disableIndex <= topIndex && topIndex != maxSegmentId) {
-          disableIndex = -1;
+
+        // Skip inactive segments inside the range, they are not steps
+        numSteps = 0;
+        appliedMask = 0;
+        for (uint16_t id = first; id <= last && numSteps < maxSteps; id++) {
+          Segment &seg = strip.getSegment(id);
+          if (!seg.isActive()) continue;
+          // Resync the applied mask with what the strip really shows
+          if (seg.getOption(SEG_OPTION_ON)) appliedMask |= (StepMask)1 << numSteps;
+          stepSegment[numSteps++] = id;
         }
-        if (disableIndex >= minSegmentId && disableIndex < maxSegmentId) {
-          strip.getSegment(disableIndex).setOption(SEG_OPTION_ON, false);
-          disableIndex--;
+        // A fixed step count is an upper bound: steps without a segment are
+        // left out of the masks, so the cascades cover the segments that exist
+        desiredMask &= fullMask();
+      }
+
+      // Number of steps covered by the staircase, capped at maxSteps
+      uint8_t stepCount() const {
+        return numSteps;
+      }
+
+      // Mask with one bit set for every step of the staircase
+      StepMask fullMask() const {
+        uint8_t steps = stepCount();
+        return steps >= maskBits ? (StepMask)~(StepMask)0 : ((StepMask)1 << steps) - 1;
+      }
+
+      // Lights on (a wavefront is lighting or holding the stairs)
+      bool isOn() const {
+        for (const Wavefront &f : fronts) {
+          if (f.state == STAIRS_SWITCHING_ON || f.state == STAIRS_ON) return true;
         }
+        return false;
       }
 
-      strip.trigger();  // Force refresh of the light strip
-      stateChanged = true;  // Notify external devices/UI of the state change
-      colorUpdated(CALL_MODE_DIRECT_CHANGE);  // Update the color to reflect changes
-    }
+      // A cascade is running and the steps have to be updated
+      bool isAnimating() const {
+        for (const Wavefront &f : fronts) {
+          if (f.state == STAIRS_SWITCHING_ON || f.state == STAIRS_SWITCHING_OFF) return true;
+        }
+        return false;
+      }
 
-    // Function to check the state of sensors and handle sensor changes
-    bool checkSensors() {
-      bool sensorChanged = false;
+      // Number of steps a cascade started at 'start' has reached by 'now'.
+      // The first step is reached immediately.
+      uint8_t cascadeSteps(unsigned long start, unsigned long now, unsigned long stepDelay) const {
+        unsigned long reached = (now - start) / stepDelay + 1;
+        return reached < stepCount() ? reached : stepCount();
+      }
+
+      // Mask of the first 'count' steps seen from the top or the bottom end
+      StepMask endMask(bool fromTop, uint8_t count) const {
+        if (count == 0) return 0;
+        StepMask mask = count >= maskBits ? (StepMask)~(StepMask)0 : ((StepMask)1 << count) - 1;
+        return fromTop ? mask : mask << (stepCount() - count);
+      }
+
+      // Whether wavefront a should be reused before b when the pool is full:
+      // fronts that are already switching off first, then the oldest one
+      static bool evictBefore(const Wavefront &a, const Wavefront &b) {
+        bool aOff = a.state == STAIRS_SWITCHING_OFF;
+        bool bOff = b.state == STAIRS_SWITCHING_OFF;
+        if (aOff != bOff) return aOff;
+        return (long)(a.lastSeen - b.lastSeen) < 0;
+      }
+
+      // Learned walking time from one end to the other (in milliseconds), 0 if unknown
+      unsigned long traversalTime(bool fromTop) const {
+        return traversal16[fromTop] >> 4;
+      }
+
+      // Step delay for a wavefront entering at the given end. With adaptive
+      // timing the cascade reaches the far end leadSteps ahead of the walker.
+      unsigned long stepDelayFor(bool fromTop) const {
+        unsigned long walk = traversalTime(fromTop);
+        if (!um->adaptiveTiming || walk == 0) return segment_delay_ms;
+        return min(um->max_step_ms, max(um->min_step_ms, walk / (stepCount() + um->leadSteps)));
+      }
+
+      // On-time for a wavefront entering at the given end. With adaptive timing
+      // this is one and a half traversals, at most the configured on-time.
+      unsigned long onTimeFor(bool fromTop) const {
+        unsigned long walk = traversalTime(fromTop);
+        if (!um->adaptiveTiming || walk == 0) return on_time_ms;
+        return min(on_time_ms, max(1000UL, walk + walk / 2));
+      }
+
+      // Longest plausible walk from one end to the other (in milliseconds),
+      // the time the slowest allowed cascade needs
+      unsigned long traversalWindow() const {
+        return (stepCount() + um->leadSteps) * um->max_step_ms;
+      }
+
+      // Number of walkers on the stairs
+      uint8_t occupancy() const {
+        return entries[LOWER] + entries[UPPER];
+      }
+
+      // Shortest plausible walk from one end to the other (in milliseconds):
+      // half the learned traversal of that direction, or one min-step-ms per step
+      unsigned long minTraversal(bool fromTop) const {
+        unsigned long walk = traversalTime(fromTop);
+        return walk ? walk / 2 : stepCount() * um->min_step_ms;
+      }
+
+      // Function to count an activation at one end as an exit of a walker
+      // from the other end or as an entry
+      void countWalker(bool atTop, unsigned long now) {
+        uint8_t *count = &entries[!atTop];
+        unsigned long *times = entryTime[!atTop];
+        for (uint8_t i = 0; i < *count; i++) {
+          long walk = now - times[i];
+          if (walk > (long)traversalWindow()) continue;  // Too long ago, still on the stairs or gone unseen
+          if (walk < (long)minTraversal(!atTop)) break;  // Too fast to be the same walker, the newer ones are even faster
+          memmove(times + i, times + i + 1, (*count - i - 1) * sizeof(*times));
+          (*count)--;
+          emptied = occupancy() == 0;
+          return;
+        }
+        count = &entries[atTop];
+        times = entryTime[atTop];
+        if (*count == maxEntries) {
+          memmove(times, times + 1, (maxEntries - 1) * sizeof(*times));  // Forget the oldest
+          (*count)--;
+        }
+        times[(*count)++] = now;
+        emptied = false;
+      }
+
+      // Function to forget all walkers once the lights are going off
+      void clearOccupancy() {
+        entries[LOWER] = entries[UPPER] = 0;
+        emptied = false;
+      }
+
+      // Function to fold a measured traversal into the estimate of its direction
+      void recordTraversal(bool fromTop, unsigned long walk) {
+        // Slower than the slowest allowed cascade: someone lingered or turned around
+        if (walk > traversalWindow()) return;
+        uint32_t &estimate = traversal16[fromTop];
+        estimate = estimate ? (3 * estimate + (walk << 4)) >> 2 : walk << 4;
+      }
+
+      // Function to start a wavefront, reusing a slot if the pool is full
+      Wavefront& startWavefront(bool fromTop, unsigned long now, unsigned long onStart) {
+        Wavefront *slot = nullptr;
+        for (Wavefront &f : fronts) {
+          if (f.state == STAIRS_OFF) { slot = &f; break; }
+          if (!slot || evictBefore(f, *slot)) slot = &f;
+        }
+        slot->onStart  = onStart;
+        slot->offStart = 0;
+        slot->lastSeen = now;
+        slot->stepDelay = stepDelayFor(fromTop);
+        slot->onTime   = onTimeFor(fromTop);
+        slot->fromTop  = fromTop;
+        slot->arrived  = false;
+        slot->state    = STAIRS_SWITCHING_ON;
+        if (index == 0) um->setStepTransition(slot->stepDelay);  // The strip transition is global, it follows the first staircase
+        return *slot;
+      }
+
+      // Function to hold all steps with a fully lit wavefront until the
+      // on-time expires, the segments are all on while the usermod is disabled
+      void holdSteps(unsigned long now) {
+        desiredMask = appliedMask = fullMask();
+        for (Wavefront &f : fronts) f.state = STAIRS_OFF;
+        Wavefront &hold = startWavefront(lastSensor, now, now);
+        hold.onStart = now - stepCount() * hold.stepDelay;
+        hold.arrived = true;  // Not a walker
+        hold.state = STAIRS_ON;
+      }
+
+      // Function to free all wavefronts without touching the segments
+      void clearFronts() {
+        for (Wavefront &f : fronts) f.state = STAIRS_OFF;
+        desiredMask = appliedMask = 0;
+        latencyPending = false;
+        clearOccupancy();
+      }
+
+      // Function to apply changed timing to the running wavefronts. Lit
+      // wavefronts take the new on-time; cascades in progress keep their
+      // step delay, so no step jumps, and new wavefronts use the new one.
+      void applyTiming() {
+        for (Wavefront &f : fronts) {
+          if (f.state == STAIRS_SWITCHING_ON || f.state == STAIRS_ON) f.onTime = onTimeFor(f.fromTop);
+        }
+      }
+
+      // Function to handle a sensor change at one end of the staircase.
+      // A rising edge starts a new wavefront unless the newest one from that end
+      // is still switching on; any edge restarts the on-time of that wavefront.
+      // It also marks the arrival of the oldest walker from the other end.
+      void sensorEvent(bool fromTop, bool active, unsigned long now) {
+        if (active) {
+          uint8_t before = occupancy();
+          countWalker(fromTop, now);
+          if (occupancy() != before) queueMqtt(now);
+
+          Wavefront *oldest = nullptr;
+          for (Wavefront &f : fronts) {
+            if (f.state == STAIRS_OFF || f.fromTop == fromTop || f.arrived) continue;
+            if (!oldest || (long)(f.onStart - oldest->onStart) < 0) oldest = &f;
+          }
+          if (oldest) {
+            oldest->arrived = true;
+            recordTraversal(oldest->fromTop, now - oldest->onStart);
+          }
+        }
+
+        Wavefront *newest = nullptr;
+        for (Wavefront &f : fronts) {
+          if (f.state == STAIRS_OFF || f.fromTop != fromTop) continue;
+          if (!newest || (long)(f.onStart - newest->onStart) > 0) newest = &f;
+        }
+        if (newest) newest->lastSeen = now;
+        if (!active || (newest && newest->state == STAIRS_SWITCHING_ON)) return;
+
+        // The first step is lit in the same loop() pass
+        startWavefront(fromTop, now, now);
+        if (!latencyPending) {
+          // Measure from the raw pin edge, before the debounce filter
+          latencyStart = filters[fromTop].raw ? filters[fromTop].rawSince : now;
+          latencyPending = true;
+        }
+      }
+
+      // Function to combine all wavefronts into the desired mask.
+      // Costs O(wavefronts) and frees the fronts whose off-cascade has finished.
+      void stepCascade(unsigned long now) {
+        desiredMask = 0;
+        for (Wavefront &f : fronts) {
+          if (f.state == STAIRS_OFF) continue;
+          uint8_t lit = cascadeSteps(f.onStart, now, f.stepDelay);
+          if (f.state == STAIRS_SWITCHING_ON && lit >= stepCount()) {
+            f.state = STAIRS_ON;
+            um->metrics.cascadeLast = now - f.onStart;
+            if (um->metrics.cascadeLast > um->metrics.cascadeMax) um->metrics.cascadeMax = um->metrics.cascadeLast;
+          }
+          StepMask mask = endMask(f.fromTop, lit);
+          if (f.state == STAIRS_SWITCHING_OFF) {
+            uint8_t dark = cascadeSteps(f.offStart, now, f.stepDelay);
+            if (dark >= stepCount()) {
+              f.state = STAIRS_OFF;  // Off-cascade finished, free the slot
+              continue;
+            }
+            mask &= ~endMask(f.fromTop, dark);
+          }
+          desiredMask |= mask;
+        }
+      }
 
-      // Check sensors only if enough time has passed since the last check
-      if ((millis() - lastScanTime) > scanDelay) {
-        lastScanTime = millis();
+      // Function to apply the desired mask to the strip in one pass, touching only
+      // the segments whose bit flipped. Returns true if any segment was switched.
+      bool updateSegments(unsigned long now) {
+        bool changed = false;
+        if (fadesSteps()) {
+          // Steps are faded by updateFades(), WLED's state does not change
+          if (desiredMask != appliedMask && !um->fading) {
+            um->fading = true;
+            um->lastFadeTime = now - um->fadeFrame();  // The first frame is due right away
+          }
+          appliedMask = desiredMask;
+          return false;
+        }
+        StepMask diff = (desiredMask ^ appliedMask) & fullMask();
+        while (diff) {
+          uint8_t step = __builtin_ctzll(diff);
+          changed |= setSegmentOn(stepSegment[step], (desiredMask >> step) & 1);
+          diff &= diff - 1;  // Clear the handled bit
+        }
+        appliedMask = desiredMask;
+        return changed;
+      }
 
-        // Read the state of the bottom and top sensors and the enable switch
-        bottomSensorRead = bottomSensorWrite || (bottomPIRorTriggerPin<0 ? false : digitalRead(bottomPIRorTriggerPin));
-        topSensorRead = topSensorWrite || (topPIRorTriggerPin<0 ? false : digitalRead(topPIRorTriggerPin));
-        enableSwitchRead = enableSwitchWrite || (enableSwitchPin<0 ? false : digitalRead(enableSwitchPin));
+      // Function to open the MQTT coalescing window if it is not open yet
+      void queueMqtt(unsigned long now) {
+        if (mqttPending) return;
+        mqttPending = true;
+        mqttPendingSince = now;
+      }
+
+#ifndef WLED_DISABLE_MQTT
+      // Function to build the publish topics of this staircase from the
+      // device topic and the topic suffix, returns true if they changed
+      bool buildTopics() {
+        char topic[sizeof(stateTopic)];
+        snprintf_P(topic, sizeof(topic), PSTR("%s/staircase%s"), mqttDeviceTopic, topicSuffix);
+        if (strcmp(topic, stateTopic) == 0) return false;
+        strcpy(stateTopic, topic);
+        for (uint8_t bottom = 0; bottom < 2; bottom++) {
+          // Formatted locally, the suffix is a member next to the topics
+          snprintf_P(topic, sizeof(topic), PSTR("%s/motion%s/%d"), mqttDeviceTopic, topicSuffix, (int)bottom);
+          strcpy(motionTopic[bottom], topic);
+        }
+        return true;
+      }
+#endif
+
+      // Function to publish the coalesced sensor states and the retained
+      // aggregate state to MQTT once the coalescing window has closed
+      void publishMqtt(unsigned long now) {
+        if (!mqttPending || (now - mqttPendingSince) < um->mqtt_coalesce_ms) return;
+        mqttPending = false;
+#ifndef WLED_DISABLE_MQTT
+        // Check if MQTT is connected to prevent crashing
+        if (!WLED_MQTT_CONNECTED || stateTopic[0] == 0) return;
+
+        // Publish the final motion state of each sensor if it differs from the last one
+        bool motion[2] = {topSensorState, bottomSensorState};
+        for (uint8_t bottom = 0; bottom < 2; bottom++) {
+          if (motion[bottom] == publishedMotion[bottom]) continue;  // Flapped back, nothing to tell
+          publishedMotion[bottom] = motion[bottom];
+          mqtt->publish(motionTopic[bottom], 0, false, motion[bottom] ? "on" : "off");
+          um->metrics.publishes++;
+        }
+
+        // Publish the retained aggregate state (on, direction, lit steps, occupancy) if it changed
+        if (statePublished && publishedOn == isOn() && publishedDir == lastSensor && publishedLit == desiredMask
+            && publishedOccupancy == occupancy()) return;
+        statePublished = true;
+        publishedOn  = isOn();
+        publishedDir = lastSensor;
+        publishedLit = desiredMask;
+        publishedOccupancy = occupancy();
+        char lit[17];
+        maskToHex(desiredMask, lit);
+        char payload[80];
+        snprintf_P(payload, sizeof(payload), PSTR("{\"on\":%s,\"dir\":\"%s\",\"lit\":\"%s\",\"occupancy\":%u}"),
+                   publishedOn ? "true" : "false", publishedDir ? "down" : "up", lit, (unsigned)publishedOccupancy);
+        mqtt->publish(stateTopic, 0, true, payload);
+        um->metrics.publishes++;
+#endif
+      }
+
+      // Function to evaluate the sensor states at the given time and handle sensor changes
+      bool updateSensorStates(unsigned long now) {
+        bool sensorChanged = false;
+
+        // Release remote sensors that have not been refreshed for the on-time
+        for (uint8_t i = 0; i < 2; i++) {
+          if (remoteLevel[i] && (long)(now - remoteSince[i]) > (long)on_time_ms) remoteLevel[i] = false;
+        }
+
+        // Combine the filtered pin levels with the overrides from the API and the remote sensors
+        bottomSensorRead = um->filterInput(filters[LOWER], sensorIndex(LOWER), readSensorPin(LOWER), now) || bottomSensorWrite || remoteLevel[LOWER];
+        topSensorRead    = um->filterInput(filters[UPPER], sensorIndex(UPPER), readSensorPin(UPPER), now) || topSensorWrite    || remoteLevel[UPPER];
 
         // Check if the state of the bottom sensor has changed
-        if (bottomSensorRead != bottomSensorState) {
+        bool bottomChanged = bottomSensorRead != bottomSensorState;
+        bool topChanged    = topSensorRead != topSensorState;
+        if (bottomChanged) {
           bottomSensorState = bottomSensorRead; // Update the previous state
           sensorChanged = true;  // Mark that a sensor change occurred
-          publishMqtt(true, bottomSensorState ? "on" : "off");  // Publish the state change via MQTT
+          queueMqtt(now);  // Publish the state change via MQTT
           DEBUG_PRINTLN(F("Bottom sensor changed."));
         }
 
         // Check if the state of the top sensor has changed
-        if (topSensorRead != topSensorState) {
+        if (topChanged) {
           topSensorState = topSensorRead; // Update the previous state
           sensorChanged = true;  // Mark that a sensor change occurred
-          publishMqtt(false, topSensorState ? "on" : "off");  // Publish the state change via MQTT
+          queueMqtt(now);  // Publish the state change via MQTT
           DEBUG_PRINTLN(F("Top sensor changed."));
         }
 
-        // Check if the state of the enable switch has changed
-        if (enableSwitchRead != enableSwitchState) {
-          enableSwitchState = enableSwitchRead; // Update the previous state
-          DEBUG_PRINTLN(F("EnableSwitch changed."));
-        }
-
-        // Reset the flags for API calls
-        topSensorWrite = false;
-        bottomSensorWrite = false;
-        enableSwitchWrite = false;
-
         // If any sensor state has changed, update the light state
         if (sensorChanged) {
-          lastSwitchTime = millis();  // Update the last switch time
+          um->metrics.edges += bottomChanged + topChanged;
           if (topSensorState || bottomSensorState) {
             // Determine the direction based on the last sensor activated
             lastSensor = topSensorRead;
           }
 
-          // Toggle power on if necessary and all segments are off
-          if (!on && togglePower && (topIndex == maxSegmentId || bottomIndex == (minSegmentId-1)) && offMode) toggleOnOff(); 
-          if (enableSwitchState == false) return false;  // Disable if the switch is off
+          // Toggle power on if necessary and all staircases are off
+          if (!um->anyOn() && um->togglePower && desiredMask == 0 && offMode) um->togglePowerState();
+          if (um->enableSwitchState == false) return sensorChanged;  // Disable if the switch is off
 
           DEBUG_PRINT(F("ON -> lastSensor "));
           DEBUG_PRINTLN(lastSensor ? F("up.") : F("down."));
 
-          // Reset the indices for the correct direction of the swipe
-          if (topSensorRead && topIndex == maxSegmentId) {
-            topIndex = minSegmentId;
+          // Start or refresh the wavefronts at the end(s) where motion changed
+          if (topChanged)    sensorEvent(UPPER, topSensorState, now);
+          if (bottomChanged) sensorEvent(LOWER, bottomSensorState, now);
+        }
+        return sensorChanged;
+      }
+
+      // Function to automatically power off the lights after the set time.
+      // Each wavefront starts its off-cascade once its entry sensor has been
+      // quiet for its on-time, or right away when the enable switch is off.
+      void autoPowerOff(unsigned long now) {
+        // With occupancy-off the stairs go dark once the last walker has left
+        // and both sensors are released, the on-time is only a safety timeout
+        bool empty = um->occupancyOff && emptied && !topSensorState && !bottomSensorState;
+        for (Wavefront &f : fronts) {
+          if (f.state != STAIRS_SWITCHING_ON && f.state != STAIRS_ON) continue;
+          if (um->enableSwitchState == true && !empty) {
+            // If the entry sensor is still on, do nothing
+            if (f.fromTop ? topSensorState : bottomSensorState) continue;
+            if ((now - f.lastSeen) <= f.onTime) continue;
           }
-          if (bottomSensorRead && bottomIndex == (minSegmentId-1)) {
-            bottomIndex = maxSegmentId-1;
+
+          // Turn off the lights from the end where this person entered
+          f.offStart = now;
+          f.state = STAIRS_SWITCHING_OFF;
+          queueMqtt(now);
+
+          DEBUG_PRINT(F("OFF -> from "));
+          DEBUG_PRINTLN(f.fromTop ? F("top.") : F("bottom."));
+        }
+        if (!isOn() && occupancy()) {
+          clearOccupancy();  // Dark stairs count as empty
+          queueMqtt(now);
+        }
+        emptied &= isOn();
+      }
+
+      // Function to update the swipe effect on the staircase.
+      // Positions follow from the wavefront start times, so this only runs when
+      // the scheduler says a step is due (or an event moved a wavefront).
+      // Returns true if a segment changed and WLED has to be notified.
+      bool updateSwipe(unsigned long now) {
+        if (!isAnimating()) return false;  // Nothing to step, stay quiescent
+
+        // Move the cascades and report whether a segment actually changed
+        StepMask previousMask = desiredMask;
+        stepCascade(now);
+        bool changed = updateSegments(now);
+        if (latencyPending) {
+          // The first step of a new wavefront has been applied
+          latencyPending = false;
+          um->metrics.latencyLast = now - latencyStart;
+          if (um->metrics.latencyLast > um->metrics.latencyMax) um->metrics.latencyMax = um->metrics.latencyLast;
+        }
+        // Publish the lit steps once the cascades have settled, not every step
+        if (desiredMask != previousMask && !isAnimating()) queueMqtt(now);
+        return changed;
+      }
+
+      // Function to move the deadline forward to the next event of this
+      // staircase. Returns false if there is work to do right away.
+      bool nextEvent(unsigned long now, unsigned long &deadline) const {
+        if (mqttPending) earliest(deadline, mqttPendingSince + um->mqtt_coalesce_ms);
+        for (uint8_t i = 0; i < 2; i++) {
+          if (remoteLevel[i]) earliest(deadline, remoteSince[i] + on_time_ms + 1);  // Expiry of a remote sensor
+        }
+        for (const InputFilter &f : filters) {
+          if (f.raw != f.stable) earliest(deadline, um->filterDeadline(f));  // A raw change is about to qualify
+        }
+        for (const Wavefront &f : fronts) {
+          if (f.state == STAIRS_OFF) continue;
+          // Next step of the on-cascade and of the off-cascade
+          uint8_t lit = cascadeSteps(f.onStart, now, f.stepDelay);
+          if (lit < stepCount()) earliest(deadline, f.onStart + lit * f.stepDelay);
+          if (f.state == STAIRS_SWITCHING_OFF) {
+            earliest(deadline, f.offStart + cascadeSteps(f.offStart, now, f.stepDelay) * f.stepDelay);
+            continue;
           }
-          on = true;  // Turn on the lights
+          // Power-off, unless the entry sensor holds the lights (its release is an event)
+          if (!um->enableSwitchState) return false;
+          if (!(f.fromTop ? topSensorState : bottomSensorState)) earliest(deadline, f.lastSeen + f.onTime + 1);
         }
+        return true;
       }
-      return sensorChanged;  // Return whether any sensor state changed
+
+      // Number of wavefronts (people) on the stairs
+      uint8_t activeFronts() const {
+        uint8_t active = 0;
+        for (const Wavefront &f : fronts) active += f.state != STAIRS_OFF;
+        return active;
+      }
+
+      // Function to write the packed status: [flags, lit steps 0-31, lit steps 32-63].
+      // flags: bit 0 on, bit 1 direction (1 = down), bits 8-15 steps, bits 16-23 wavefronts, bits 24-31 occupancy
+      void writeCompactStatus(JsonObject& staircase) {
+        JsonArray status = staircase.createNestedArray("st");
+        status.add((uint32_t)isOn() | (uint32_t)lastSensor << 1 | (uint32_t)stepCount() << 8 | (uint32_t)activeFronts() << 16
+                   | (uint32_t)occupancy() << 24);
+        status.add((uint32_t)(desiredMask & 0xFFFFFFFF));
+        status.add((uint32_t)((uint64_t)desiredMask >> 32));
+      }
+
+      // Function to send sensor values to the JSON API.
+      // Keys are plain literals, ArduinoJson stores them without copying.
+      void writeSensorsToJson(JsonObject& staircase) {
+        staircase["top-sensor"]    = topSensorRead;  // Current state of the top sensor
+        staircase["bottom-sensor"] = bottomSensorRead;  // Current state of the bottom sensor
+        staircase["on"] = isOn();  // Whether the staircase lights are on
+        staircase["steps"] = stepCount();  // Number of steps in the staircase
+        staircase["fronts"] = activeFronts();  // Number of wavefronts (people) on the stairs
+        staircase["occupancy"] = occupancy();  // Walkers counted on the stairs
+        char lit[17];
+        maskToHex(desiredMask, lit);
+        staircase["lit"] = lit;  // Lit steps as a hex bitmask, bit 0 is the top step (stepSegment[0])
+        JsonArray glitches = staircase.createNestedArray("glitches");  // Rejected glitches: top, bottom, enable switch
+        glitches.add(filters[UPPER].glitches);
+        glitches.add(filters[LOWER].glitches);
+        glitches.add(um->enableFilter.glitches);
+        if (um->adaptiveTiming) {
+          JsonArray walk = staircase.createNestedArray("traversal-ms");  // Learned walking time: down, up
+          walk.add(traversalTime(UPPER));
+          walk.add(traversalTime(LOWER));
+        }
+        if (distanceSensor(UPPER) || distanceSensor(LOWER)) {
+          JsonArray dist = staircase.createNestedArray("distance-cm");  // Last distances: top, bottom, 0 = nothing in range
+          dist.add(distance[UPPER]);
+          dist.add(distance[LOWER]);
+        }
+      }
+
+      // Function to allow overriding sensor values via the JSON API.
+      // Only the sensors named in the request are touched.
+      void readSensorsFromJson(JsonObject& staircase) {
+        unsigned long now = millis();
+        if (!staircase["bottom-sensor"].isNull()) {
+          bool value = staircase["bottom-sensor"].as<bool>();
+          um->traceRecord(value ? TRACE_JSON_ON : TRACE_JSON_OFF, sensorIndex(LOWER), now);
+          bottomSensorWrite = bottomSensorState || value;  // Override bottom sensor state
+        }
+        if (!staircase["top-sensor"].isNull()) {
+          bool value = staircase["top-sensor"].as<bool>();
+          um->traceRecord(value ? TRACE_JSON_ON : TRACE_JSON_OFF, sensorIndex(UPPER), now);
+          topSensorWrite = topSensorState || value;  // Override top sensor state
+        }
+      }
+
+      // Config key of a per-staircase setting: the plain name for the first
+      // staircase, name-<index> for the others. The keys stay flat fields of
+      // the staircase object, which the WLED settings page can edit.
+      char *configKey(const char *name, char *buf) const {
+        strcpy_P(buf, name);
+        if (index > 0) sprintf_P(buf + strlen(buf), PSTR("-%d"), (int)index);
+        return buf;
+      }
+
+      // Function to write the settings of this staircase to the staircase config object
+      void writeConfig(JsonObject& cfg) {
+        char key[28];
+        cfg[configKey(_segmentDelay, key)]           = segment_delay_ms;  // Save the segment delay
+        cfg[configKey(_onTime, key)]                 = on_time_ms / 1000;  // Save the on-time (in seconds)
+        cfg[configKey(_topPIRorTrigger_pin, key)]    = topPIRorTriggerPin;  // Save the top sensor pin
+        cfg[configKey(_bottomPIRorTrigger_pin, key)] = bottomPIRorTriggerPin;  // Save the bottom sensor pin
+        cfg[configKey(_topEcho_pin, key)]            = topEchoPin;  // Save the top echo pin
+        cfg[configKey(_bottomEcho_pin, key)]         = bottomEchoPin;  // Save the bottom echo pin
+        cfg[configKey(_topMaxDist, key)]             = topMaxDist_cm;  // Save the top distance threshold
+        cfg[configKey(_bottomMaxDist, key)]          = bottomMaxDist_cm;  // Save the bottom distance threshold
+        cfg[configKey(_firstSegment, key)]           = firstSegment;  // Save the segment of the top step
+        cfg[configKey(_lastSegment, key)]            = lastSegment;  // Save the segment of the bottom step
+        cfg[configKey(_topicSuffix, key)]            = (const char *)topicSuffix;  // Save the MQTT topic suffix
+      }
+
+      // Function to read the settings of this staircase from the staircase config object
+      void readConfig(JsonObject& cfg) {
+        char key[28];
+        segment_delay_ms = cfg[configKey(_segmentDelay, key)] | segment_delay_ms;
+        segment_delay_ms = (unsigned long) min((unsigned long)10000,max((unsigned long)10,(unsigned long)segment_delay_ms));  // max delay 10s
+
+        on_time_ms = cfg[configKey(_onTime, key)] | on_time_ms/1000;
+        on_time_ms = min(900,max(1,(int)on_time_ms)) * 1000; // min 1s, max 15min
+
+        topPIRorTriggerPin = cfg[configKey(_topPIRorTrigger_pin, key)] | topPIRorTriggerPin;
+        bottomPIRorTriggerPin = cfg[configKey(_bottomPIRorTrigger_pin, key)] | bottomPIRorTriggerPin;
+        topEchoPin = cfg[configKey(_topEcho_pin, key)] | topEchoPin;
+        bottomEchoPin = cfg[configKey(_bottomEcho_pin, key)] | bottomEchoPin;
+        topMaxDist_cm = min(400U, (unsigned int)(cfg[configKey(_topMaxDist, key)] | topMaxDist_cm));  // max 4m, the echo timeout
+        bottomMaxDist_cm = min(400U, (unsigned int)(cfg[configKey(_bottomMaxDist, key)] | bottomMaxDist_cm));
+        firstSegment = min((int)strip.getMaxSegments() - 1, max(-1, cfg[configKey(_firstSegment, key)] | (int)firstSegment));  // -1 = main segment
+        lastSegment = min((int)strip.getMaxSegments() - 1, max(-1, cfg[configKey(_lastSegment, key)] | (int)lastSegment));  // -1 = last active segment
+        strlcpy(topicSuffix, cfg[configKey(_topicSuffix, key)] | "", sizeof(topicSuffix));
+        if (topicSuffix[0] == 0 && index > 0) snprintf_P(topicSuffix, sizeof(topicSuffix), PSTR("/%d"), (int)index);  // Topics must not collide
+      }
+    };
+
+    Flight flights[maxFlights];
+    uint8_t numFlights = 1;  // Configured staircases, flights[0] always exists
+
+    unsigned long stepTransition = 150;  // Step delay the strip transition and the fades currently use (in milliseconds)
+
+    // Timestamp of the last sensor check (in milliseconds)
+    unsigned long lastScanTime = 0;
+
+    // Scheduler: loop() does nothing until the earliest of the next step, the
+    // next power-off and the next sensor poll of any staircase, or until an
+    // input event arrives.
+    static const unsigned long maxIdle = 60000;  // Upper bound for the deadline (in milliseconds)
+    unsigned long nextDeadline = 0;  // millis() at which loop() has work to do again
+    bool wakeup = true;              // An input event arrived, run loop() right away
+
+    uint8_t cachedSegmentsNum = 0;  // strip.getSegmentsNum() when the step lists were built
+    bool segmentsDirty = true;      // Step lists have to be rebuilt before the next use
+    bool committing = false;        // Our own colorUpdated() call is in progress
+
+    // Single segment mode: the step map splits the first segment of the first
+    // staircase into LED ranges, one per step, and each step is faded by the
+    // usermod itself.
+    uint16_t stepLeds[maxSteps] = {0};        // Configured LEDs per step, 0 = equal share of the segment
+    uint16_t stepStart[maxSteps + 1] = {0};   // First LED of each step (absolute), last entry is the end
+    uint8_t stepLevel[maxSteps] = {0};        // Linear fade progress per step, 0 = off, 255 = fully lit
+    unsigned long lastFadeTime = 0;           // Timestamp of the last fade update (in milliseconds)
+    bool fading = false;                      // A step has not reached its target level yet
+    static const uint8_t fadeInterval = 20;   // Fades are stepped at most once per strip frame (in milliseconds)
+
+    Metrics metrics;
+
+    // Input trace ring buffer, see TraceKind. When it is full the oldest
+    // records are dropped; traceBase is then advanced by their deltas, so
+    // the first record in the buffer always starts at traceBase + its delta.
+    uint8_t trace[traceBytes];
+    uint16_t traceTail = 0;          // Offset of the oldest record
+    uint16_t traceUsed = 0;          // Bytes in use
+    unsigned long traceBase = 0;     // Time the delta of the oldest record is relative to (in milliseconds)
+    unsigned long traceLast = 0;     // Time of the newest record (in milliseconds)
+    uint32_t traceDropped = 0;       // Records dropped to make room
+    bool traceRequested = false;     // Add the trace to the next JSON state
+
+    // State of the enable switch, shared by all staircases and used by the API
+    bool enableSwitchRead  = false;
+    bool enableSwitchWrite = false;
+    bool enableSwitchState = false;
+    InputFilter enableFilter = {};
+
+    // Pin-change interrupt capture of the sensor pins.
+    // The ISRs push timestamped edges into a single-producer/single-consumer
+    // ring buffer which loop() drains. Pins that cannot take an interrupt are
+    // polled every scanDelay instead.
+    static const uint8_t edgeQueueSize = 16;          // must be a power of two
+    static volatile unsigned long edgeTime[edgeQueueSize];  // millis() of each edge
+    static volatile uint8_t edgeLevel[edgeQueueSize];       // bit 0: pin level, bits 1-7: sensor number
+    static volatile uint8_t edgeHead;                 // written by the ISRs only
+    static volatile uint8_t edgeTail;                 // written by loop() only
+    static volatile bool edgeOverflow;                // an edge was dropped, resync by polling
+    static int8_t isrPin[maxSensors];                 // pins attached to the ISRs, indexed by sensor number
+
+    // Ultrasonic distance sensors. The PIR pin of an end becomes the trigger pin
+    // and the echo pulse is timed from pin-change interrupt timestamps, so loop()
+    // never waits for an echo the way pulseIn() does. Only one ping is in flight
+    // at a time and the sensors of all staircases take turns, so they cannot
+    // hear each other's echo.
+    static const unsigned long pingInterval = 60;     // Minimum time between two pings of the same sensor (in milliseconds), the HC-SR04 cycle
+    static const unsigned long pingGap      = 40;     // Minimum time between two pings of any sensors (in milliseconds), longer than the 38ms no-target echo
+    static const unsigned long echoTimeout  = 25;     // No echo within this means nothing in range (in milliseconds), about 4m
+    static volatile unsigned long echoRise[maxSensors];   // micros() of the rising echo edge, indexed by sensor number
+    static volatile unsigned long echoWidth[maxSensors];  // width of the last echo pulse (in microseconds), 0 while pending
+    static volatile bool echoReady;                   // an echo pulse has ended, run loop() right away
+    static int8_t echoIsrPin[maxSensors];             // echo pins attached to the ISRs, indexed by sensor number
+    int8_t pingSensor = -1;                           // sensor number with a ping in flight, -1 means none
+    uint8_t lastPing = 0;                             // sensor number that was pinged last
+    unsigned long pingTime = 0;                       // millis() of the last ping
+    unsigned long sensorPingTime[maxSensors] = {};    // millis() of the last ping, indexed by sensor number
+
+
+    // Called from interrupt context: record the edge and nothing else
+    static void IRAM_ATTR pushSensorEdge(uint8_t sensor) {
+      uint8_t head = edgeHead;
+      uint8_t next = (head + 1) & (edgeQueueSize - 1);
+      if (next == edgeTail) {
+        edgeOverflow = true;  // Queue full, loop() will resync from the pins
+        return;
+      }
+      edgeTime[head]  = millis();
+      edgeLevel[head] = (sensor << 1) | (digitalRead(isrPin[sensor]) ? 1 : 0);
+      edgeHead = next;  // Publish the entry only after it has been written
+    }
+    static void IRAM_ATTR sensorIsr(void *arg) { pushSensorEdge((uintptr_t)arg); }
+
+    // Called from interrupt context: time the echo pulse of a distance sensor
+    static void IRAM_ATTR echoEdge(uint8_t sensor) {
+      unsigned long time = micros();
+      if (digitalRead(echoIsrPin[sensor])) {
+        echoRise[sensor] = time ? time : 1;  // 0 is reserved for no rising edge since the ping
+        return;
+      }
+      if (!echoRise[sensor]) return;  // The tail of an earlier pulse, not the echo of this ping
+      unsigned long width = time - echoRise[sensor];
+      echoWidth[sensor] = width ? width : 1;  // 0 is reserved for pending
+      echoReady = true;
     }
+    static void IRAM_ATTR echoIsr(void *arg) { echoEdge((uintptr_t)arg); }
 
-    // Function to automatically power off the lights after the set time
-    void autoPowerOff() {
-      if ((millis() - lastSwitchTime) > on_time_ms || enableSwitchState == false) {
-        // If sensors are still on, do nothing
-        if (enableSwitchState == true && (bottomSensorState || topSensorState)) return;
+    // Staircase of a sensor number, the end is bit 0
+    Flight& flightOf(uint8_t sensor) { return flights[sensor >> 1]; }
+    const Flight& flightOf(uint8_t sensor) const { return flights[sensor >> 1]; }
 
-        // Turn off the lights in the direction of the last sensor activation
-        swipe = lastSensor;
-        if (lastSensor) {
-          disableIndex = minSegmentId;
-        } else {
-          disableIndex = maxSegmentId - 1;
+    // Any staircase has an ultrasonic sensor, so the ping state machine has to run
+    bool distanceSensors() const {
+      for (uint8_t i = 0; i < numFlights * 2; i++) {
+        if (flightOf(i).distanceSensor(i & 1)) return true;
+      }
+      return false;
+    }
+
+    // Attach the pin-change interrupts for all sensor pins that support them.
+    // The sensor number is passed to the shared handlers as their argument.
+    void attachSensorInterrupts() {
+      detachSensorInterrupts();
+
+      // Echo pulses can only be timed without blocking by an interrupt
+      for (uint8_t i = 0; i < numFlights * 2; i++) {
+        Flight &f = flightOf(i);
+        f.inRange[i & 1] = false;
+        if (!f.distanceSensor(i & 1)) continue;
+        if (digitalPinToInterrupt(f.echoPin(i & 1)) == NOT_AN_INTERRUPT) {
+          DEBUG_PRINTLN(F("Staircase: echo pin without interrupt, sensor ignored."));
+          continue;
+        }
+        echoIsrPin[i] = f.echoPin(i & 1);
+        attachInterruptArg(digitalPinToInterrupt(echoIsrPin[i]), echoIsr, (void *)(uintptr_t)i, CHANGE);
+      }
+      pingSensor = -1;
+
+      if (!useInterrupts) return;
+      edgeTail = edgeHead;  // Discard stale edges
+      edgeOverflow = false;
+      for (uint8_t i = 0; i < numFlights * 2; i++) {
+        Flight &f = flightOf(i);
+        if (!f.pirSensor(i & 1) || digitalPinToInterrupt(f.triggerPin(i & 1)) == NOT_AN_INTERRUPT) continue;
+        isrPin[i] = f.triggerPin(i & 1);
+        f.sensorLevel[i & 1] = digitalRead(isrPin[i]);
+        attachInterruptArg(digitalPinToInterrupt(isrPin[i]), sensorIsr, (void *)(uintptr_t)i, CHANGE);
+      }
+    }
+
+    void detachSensorInterrupts() {
+      for (uint8_t i = 0; i < maxSensors; i++) {
+        if (isrPin[i] < 0) continue;
+        detachInterrupt(digitalPinToInterrupt(isrPin[i]));
+        isrPin[i] = -1;
+      }
+      for (uint8_t i = 0; i < maxSensors; i++) {
+        if (echoIsrPin[i] < 0) continue;
+        detachInterrupt(digitalPinToInterrupt(echoIsrPin[i]));
+        echoIsrPin[i] = -1;
+      }
+      pingSensor = -1;
+    }
+
+    // millis() at which the next distance sensor may be pinged: pingGap after
+    // the last ping and pingInterval after the last ping of that sensor
+    unsigned long nextPingTime() const {
+      unsigned long time = 0;
+      bool found = false;
+      for (uint8_t i = 0; i < numFlights * 2; i++) {
+        if (!flightOf(i).distanceSensor(i & 1)) continue;
+        unsigned long due = sensorPingTime[i] + pingInterval;
+        if (!found || (long)(due - time) < 0) time = due;
+        found = true;
+      }
+      if ((long)(pingTime + pingGap - time) > 0) time = pingTime + pingGap;
+      return time;
+    }
+
+    // Function to run the ping state machine of the distance sensors: evaluate
+    // the echo of the ping in flight, then ping the next sensor that is due.
+    // The 10us trigger pulse is the only wait.
+    void updateDistanceSensors(unsigned long now) {
+      echoReady = false;
+      if (pingSensor >= 0) {
+        unsigned long width = echoWidth[pingSensor];
+        if (width == 0 && (now - pingTime) < echoTimeout) return;  // Echo still pending
+        Flight &f = flightOf(pingSensor);
+        bool end = pingSensor & 1;
+        unsigned long cm = width / 58;  // Sound travels 1cm and back in about 58us
+        unsigned int maxDist = end == UPPER ? f.topMaxDist_cm : f.bottomMaxDist_cm;
+        f.distance[end] = width ? min(cm, 65535UL) : 0;
+        f.inRange[end] = width && cm <= maxDist;
+        pingSensor = -1;
+      }
+      if ((now - pingTime) < pingGap) return;
+
+      // The sensors take turns, a single sensor is pinged every time
+      uint8_t count = numFlights * 2;
+      int8_t next = -1;
+      for (uint8_t i = 1; i <= count && next < 0; i++) {
+        uint8_t sensor = (lastPing + i) % count;
+        if (flightOf(sensor).distanceSensor(sensor & 1) && (now - sensorPingTime[sensor]) >= pingInterval) next = sensor;
+      }
+      if (next < 0) return;
+      int8_t pin = flightOf(next).triggerPin(next & 1);
+      echoWidth[next] = 0;
+      echoRise[next] = 0;
+      digitalWrite(pin, HIGH);
+      delayMicroseconds(10);
+      digitalWrite(pin, LOW);
+      pingSensor = next;
+      lastPing = next;
+      pingTime = now;
+      sensorPingTime[next] = now;
+    }
+
+    // Remote sensors: a fixed 8 byte datagram per edge, parsed in place
+    //   0-1  'S', 'T'
+    //   2    sensor number (staircase * 2 + end, 1 = top)
+    //   3    edge: 1 = active, 0 = released
+    //   4-7  sequence number, little endian
+    // Datagrams with a sequence number not after the last accepted one of
+    // the same sensor are duplicates or stale and dropped; 0 marks a
+    // restarted sender and is always accepted.
+    static const uint8_t udpPacketSize = 8;
+    static const uint8_t udpBurst = 4;  // Datagrams handled per poll
+    static const uint8_t udpPollInterval = 20;  // Time between socket polls (in milliseconds)
+    WiFiUDP udp;
+    bool udpActive = false;  // The socket is bound to udpPort
+    unsigned long lastUdpPoll = 0;  // Time of the last socket poll (in milliseconds)
+
+    // Function to (re)bind the UDP socket to the configured port
+    void startUdp() {
+      stopUdp();
+      if (udpPort == 0 || !WLED_CONNECTED) return;
+      udpActive = udp.begin(udpPort);
+      wakeup = true;  // Put the socket poll on the deadline
+      DEBUG_PRINTLN(udpActive ? F("Staircase: UDP sensors listening.") : F("Staircase: UDP port not available."));
+    }
+
+    void stopUdp() {
+      if (udpActive) udp.stop();
+      udpActive = false;
+    }
+
+    // Function to apply the remote sensor datagrams waiting on the socket
+    void receiveUdp(unsigned long now) {
+      for (uint8_t n = 0; n < udpBurst; n++) {
+        int size = udp.parsePacket();
+        if (size <= 0) break;
+        uint8_t packet[udpPacketSize];
+        int len = udp.read(packet, sizeof(packet));
+        if (size != udpPacketSize || len != udpPacketSize || packet[0] != 'S' || packet[1] != 'T'
+            || packet[2] >= numFlights * 2 || packet[3] > 1) {
+          metrics.udpRejected++;
+          continue;
+        }
+        uint8_t sensor = packet[2];
+        Flight &f = flightOf(sensor);
+        bool end = sensor & 1;
+        uint32_t seq = packet[4] | (uint32_t)packet[5] << 8 | (uint32_t)packet[6] << 16 | (uint32_t)packet[7] << 24;
+        if (f.remoteSeen[end] && seq != 0 && (int32_t)(seq - f.remoteSeq[end]) <= 0) {
+          metrics.udpRejected++;  // Duplicate or reordered
+          continue;
+        }
+        f.remoteSeen[end]  = true;
+        f.remoteSeq[end]   = seq;
+        f.remoteLevel[end] = packet[3];
+        f.remoteSince[end] = now;
+        traceRecord(packet[3] ? TRACE_UDP_HIGH : TRACE_UDP_LOW, sensor, now);
+        metrics.udpAccepted++;
+      }
+    }
+
+    // Function to format a step mask as 16 hex digits, buf needs 17 bytes
+    static void maskToHex(uint64_t mask, char *buf) {
+      sprintf_P(buf, PSTR("%08lx%08lx"), (unsigned long)(mask >> 32), (unsigned long)(mask & 0xFFFFFFFF));
+    }
+
+    // Function to reset the runtime metrics
+    void resetMetrics() {
+      metrics = Metrics();
+    }
+
+    // Function to record the duration of a loop() pass that did work
+    void recordLoopTime(uint32_t us) {
+      if (metrics.loopPasses++ == 0) metrics.loopAvg16 = us << 4;
+      else metrics.loopAvg16 += us - (metrics.loopAvg16 >> 4);  // avg += (us - avg) / 16
+      if (us < metrics.loopMin) metrics.loopMin = us;
+      if (us > metrics.loopMax) metrics.loopMax = us;
+      uint8_t bucket = 0;
+      for (uint32_t t = us >> 5; t && bucket < loopBuckets - 1; t >>= 1) bucket++;  // Power of two buckets
+      if (metrics.loopHist[bucket] < UINT16_MAX) metrics.loopHist[bucket]++;
+    }
+
+    // Function to redraw the strip, counted in the metrics
+    void triggerStrip() {
+      strip.trigger();
+      metrics.triggers++;
+    }
+
+    // Function to toggle WLED's power, counted in the metrics
+    void togglePowerState() {
+      toggleOnOff();
+      metrics.toggles++;
+    }
+
+    // Function to push segment changes to the strip and notify WLED.
+    // All writes to the strip go through here so they can be counted.
+    void commitSegments() {
+      triggerStrip();  // Force refresh of the light strip
+      stateChanged = true;  // Notify external devices/UI of the state change
+      committing = true;  // Our own state change does not alter the segment layout
+      colorUpdated(CALL_MODE_DIRECT_CHANGE);  // Update the color to reflect changes
+      committing = false;
+    }
+
+    // Function to rebuild the cached step lists of all staircases
+    void refreshSegments() {
+      cachedSegmentsNum = strip.getSegmentsNum();
+      for (uint8_t i = 0; i < numFlights; i++) flights[i].refreshSegments();
+      segmentsDirty = false;
+    }
+
+    // Function to switch a single segment, returns true if its state actually changed
+    static bool setSegmentOn(uint8_t id, bool value) {
+      Segment &seg = strip.getSegment(id);
+      if (seg.getOption(SEG_OPTION_ON) == value) return false;
+      seg.setOption(SEG_OPTION_ON, value);
+      return true;
+    }
+
+    // Function to split a segment into LED ranges according to the step map
+    void refreshStepMap(Flight &flight, uint8_t id) {
+      Segment &seg = strip.getSegment(id);
+      flight.numSteps = Steps ? Steps : min(ledSteps, (uint8_t)maxSteps);
+      uint16_t share = flight.numSteps ? seg.length() / flight.numSteps : 0;
+      uint16_t led = seg.start;
+      for (uint8_t i = 0; i < flight.numSteps; i++) {
+        stepStart[i] = led;
+        led = min((uint16_t)seg.stop, (uint16_t)(led + (stepLeds[i] ? stepLeds[i] : share)));
+      }
+      stepStart[flight.numSteps] = led;
+      flight.desiredMask &= flight.fullMask();
+      flight.appliedMask = flight.desiredMask;  // There are no segment states to resync with
+    }
+
+    // Eased and gamma corrected brightness for a linear fade level, interpolated
+    // between the 33 entries of the lookup table in 8.8 fixed point
+    static uint8_t fadeBrightness(uint8_t level) {
+      uint8_t i = level >> 3;
+      uint8_t a = pgm_read_byte(&_fadeLut[i]);
+      uint8_t b = pgm_read_byte(&_fadeLut[i + 1]);
+      return a + (((b - a) * (level & 7)) >> 3);
+    }
+
+    // Time between two fade updates: one strip frame, or longer for slow
+    // fades so that every update moves the levels (in milliseconds)
+    unsigned long fadeFrame() const {
+      return max((unsigned long)fadeInterval, (stepTransition + 254) / 255);
+    }
+
+    // Function to move the step levels towards their target, one full fade
+    // takes one step delay like the segment transitions in the default mode
+    void updateFades(unsigned long now) {
+      if (!fading || (long)(now - lastFadeTime) < (long)fadeFrame()) return;
+      unsigned long delta = ((now - lastFadeTime) * 255) / max(stepTransition, 1UL);
+      lastFadeTime = now;
+
+      const Flight &flight = flights[0];
+      bool moved = false;
+      fading = false;
+      for (uint8_t i = 0; i < flight.stepCount(); i++) {
+        uint8_t target = (flight.desiredMask >> i) & 1 ? 255 : 0;
+        if (stepLevel[i] == target) continue;
+        if (target) stepLevel[i] = min(255UL, stepLevel[i] + delta);
+        else        stepLevel[i] = stepLevel[i] > delta ? stepLevel[i] - delta : 0;
+        fading |= stepLevel[i] != target;
+        moved = true;
+      }
+      if (moved) triggerStrip();  // Redraw without a WLED state change
+    }
+
+    // Function to jump every step to its target level without fading
+    void settleFades() {
+      for (uint8_t i = 0; i < maxSteps; i++) stepLevel[i] = (flights[0].desiredMask >> i) & 1 ? 255 : 0;
+      fading = false;
+    }
+
+    // Lights on in any staircase
+    bool anyOn() const {
+      for (uint8_t i = 0; i < numFlights; i++) {
+        if (flights[i].isOn()) return true;
+      }
+      return false;
+    }
+
+    // A cascade is running in any staircase
+    bool anyAnimating() const {
+      for (uint8_t i = 0; i < numFlights; i++) {
+        if (flights[i].isAnimating()) return true;
+      }
+      return false;
+    }
+
+    // Function to apply a step delay to the strip transition (and the fades).
+    // The transition is global to the strip, so only the first staircase sets it.
+    void setStepTransition(unsigned long stepDelay) {
+      if (stepDelay == stepTransition) return;
+      stepTransition = stepDelay;
+      transitionDelay = stepDelay;
+      strip.setTransition(stepDelay);
+    }
+
+    // Function to clear the input trace
+    void traceClear() {
+      traceTail = traceUsed = 0;
+      traceDropped = 0;
+    }
+
+    // Function to read the varint at a trace offset, advancing the offset
+    uint32_t traceVarint(uint16_t &pos) const {
+      uint32_t value = 0;
+      for (uint8_t shift = 0; shift < 35; shift += 7) {
+        uint8_t b = trace[pos];
+        pos = (pos + 1) % traceBytes;
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+      }
+      return value;
+    }
+
+    // Function to append an input to the trace. Inputs are recorded in the
+    // order they are processed; an edge timestamped before the previous
+    // record gets a zero delta.
+    void traceRecord(uint8_t kind, uint8_t input, unsigned long time) {
+      if (!STAIRS_TRACE_BYTES || !traceInputs) return;
+      if (traceUsed == 0) traceBase = traceLast = time;
+      uint32_t delta = (long)(time - traceLast) > 0 ? time - traceLast : 0;
+      traceLast += delta;
+
+      uint8_t record[6];
+      uint8_t len = 0;
+      record[len++] = kind << 5 | (input & 0x1F);
+      do {
+        record[len] = delta & 0x7F;
+        delta >>= 7;
+        if (delta) record[len] |= 0x80;
+        len++;
+      } while (delta);
+
+      // Drop the oldest records until the new one fits
+      while (traceUsed + len > traceBytes) {
+        uint16_t pos = (traceTail + 1) % traceBytes;
+        traceBase += traceVarint(pos);
+        traceUsed -= (pos + traceBytes - traceTail) % traceBytes;
+        traceTail = pos;
+        traceDropped++;
+      }
+      for (uint8_t i = 0; i < len; i++) trace[(traceTail + traceUsed++) % traceBytes] = record[i];
+    }
+
+    // Function to write the input trace to the JSON API as hex strings of up
+    // to 64 bytes each, formatted on the stack
+    void writeTraceToJson(JsonObject& staircase) {
+      JsonObject t = staircase.createNestedObject("trace");
+      t["base"]    = traceBase;  // millis() the first delta is relative to
+      t["now"]     = millis();  // millis() when the trace was read
+      t["dropped"] = traceDropped;  // Records dropped since the trace was cleared
+      JsonArray data = t.createNestedArray("data");
+      char hex[129];
+      for (uint16_t done = 0; done < traceUsed; ) {
+        uint8_t chunk = min(64, traceUsed - done);
+        for (uint8_t i = 0; i < chunk; i++) sprintf_P(hex + 2 * i, PSTR("%02x"), trace[(traceTail + done + i) % traceBytes]);
+        data.add(hex);
+        done += chunk;
+      }
+    }
+
+    // Function to feed a raw input level into its debounce filter, returns the filtered level
+    bool filterInput(InputFilter &f, uint8_t input, bool level, unsigned long now) {
+      if (level != f.raw) {
+        traceRecord(level ? TRACE_HIGH : TRACE_LOW, input, now);
+        // Back to the filtered level before the change qualified: a glitch
+        if (level == f.stable && f.glitches < UINT16_MAX) f.glitches++;
+        f.raw = level;
+        f.rawSince = now;
+      }
+      unsigned long hold = f.raw ? min_pulse_ms : release_ms;
+      if (f.raw != f.stable && (long)(now - f.rawSince) >= (long)hold) f.stable = f.raw;
+      return f.stable;
+    }
+
+    // Time at which a pending raw change of an input qualifies
+    unsigned long filterDeadline(const InputFilter &f) const {
+      return f.rawSince + (f.raw ? min_pulse_ms : release_ms);
+    }
+
+    // Function to process the edges captured by the sensor interrupts
+    bool drainSensorEdges(unsigned long now) {
+      bool sensorChanged = false;
+      while (edgeTail != edgeHead) {
+        uint8_t tail = edgeTail;
+        unsigned long time = edgeTime[tail];
+        uint8_t level = edgeLevel[tail];
+        edgeTail = (tail + 1) & (edgeQueueSize - 1);  // Free the entry for the ISR
+
+        uint8_t sensor = level >> 1;
+        if (sensor >= numFlights * 2) continue;  // Edge from before a reconfiguration
+        Flight &f = flightOf(sensor);
+        f.sensorLevel[sensor & 1] = level & 1;
+        sensorChanged |= f.updateSensorStates(time);  // Evaluate at the exact edge time
+      }
+      if (edgeOverflow) {
+        // Edges were dropped, take the current pin levels as the truth
+        edgeOverflow = false;
+        for (uint8_t i = 0; i < numFlights * 2; i++) {
+          if (isrPin[i] >= 0) flightOf(i).sensorLevel[i & 1] = digitalRead(isrPin[i]);
         }
-        on = false;  // Turn off the lights
+        for (uint8_t i = 0; i < numFlights; i++) sensorChanged |= flights[i].updateSensorStates(now);
+      }
+      return sensorChanged;
+    }
+
+    // Function to check the state of sensors and handle sensor changes
+    bool checkSensors(unsigned long now) {
+      if (distanceSensors()) updateDistanceSensors(now);
+      bool sensorChanged = drainSensorEdges(now);
+
+      // Read the state of the enable switch
+      enableSwitchRead = filterInput(enableFilter, traceEnableSwitch, enableSwitchPin<0 ? false : digitalRead(enableSwitchPin), now) || enableSwitchWrite;
 
-        DEBUG_PRINT(F("OFF -> lastSensor "));
-        DEBUG_PRINTLN(lastSensor ? F("up.") : F("down."));
+      // Check if the state of the enable switch has changed
+      if (enableSwitchRead != enableSwitchState) {
+        enableSwitchState = enableSwitchRead; // Update the previous state
+        DEBUG_PRINTLN(F("EnableSwitch changed."));
       }
+
+      // Sensors without an interrupt are only seen here, the scheduler runs
+      // this at least every scanDelay while such pins exist. This also lets
+      // pending debounce filters qualify.
+      for (uint8_t i = 0; i < numFlights; i++) sensorChanged |= flights[i].updateSensorStates(now);
+
+      // Reset the flags for API calls once they have been seen for a scan period
+      if ((now - lastScanTime) > scanDelay) {
+        lastScanTime = now;
+        for (uint8_t i = 0; i < numFlights; i++) {
+          flights[i].topSensorWrite = false;
+          flights[i].bottomSensorWrite = false;
+        }
+        enableSwitchWrite = false;
+      }
+      return sensorChanged;  // Return whether any sensor state changed
     }
 
-    // Function to update the swipe effect on the staircase
-    void updateSwipe() {
-      if ((millis() - lastTime) > segment_delay_ms) {
-        lastTime = millis();  // Update the last action time
+    // Sensor pins without an interrupt and the enable switch have to be polled
+    bool needsPolling() const {
+      if (enableSwitchPin >= 0 || enableSwitchWrite) return true;
+      for (uint8_t i = 0; i < numFlights * 2; i++) {
+        if (flightOf(i).pirSensor(i & 1) && isrPin[i] < 0) return true;
+      }
+      for (uint8_t i = 0; i < numFlights; i++) {
+        if (flights[i].topSensorWrite || flights[i].bottomSensorWrite) return true;  // API overrides are cleared by the next poll
+      }
+      return false;
+    }
+
+    // Move the deadline forward to 'time' if that is earlier
+    static void earliest(unsigned long &deadline, unsigned long time) {
+      if ((long)(time - deadline) < 0) deadline = time;
+    }
 
-        updateSegments();  // Update the light segments based on the swipe direction
-        // Toggle power off if necessary and all segments are off
-        if (togglePower && (topIndex == maxSegmentId || bottomIndex == (minSegmentId-1)) && !offMode && !on) toggleOnOff();  
+    // Function to compute when loop() has work to do next, the earliest
+    // event of all staircases
+    unsigned long computeDeadline(unsigned long now) const {
+      unsigned long deadline = now + maxIdle;
+      if (fading) earliest(deadline, lastFadeTime + fadeFrame());  // Next fade frame
+      if (needsPolling()) earliest(deadline, lastScanTime + scanDelay + 1);
+      if (pingSensor >= 0) earliest(deadline, pingTime + echoTimeout);  // An echo ends earlier with an event
+      else if (distanceSensors()) earliest(deadline, nextPingTime());
+      if (enableFilter.raw != enableFilter.stable) earliest(deadline, filterDeadline(enableFilter));  // A raw change is about to qualify
+      if (udpActive) earliest(deadline, lastUdpPoll + udpPollInterval);  // The socket has no interrupt
+      for (uint8_t i = 0; i < numFlights; i++) {
+        if (!flights[i].nextEvent(now, deadline)) return now;
       }
+      return deadline;
     }
 
-    // Function to send sensor values to the JSON API
-    void writeSensorsToJson(JsonObject& staircase) {
-      staircase[F("top-sensor")]    = topSensorRead;  // Current state of the top sensor
-      staircase[F("bottom-sensor")] = bottomSensorRead;  // Current state of the bottom sensor
-      staircase[F("enable-switch")] = enableSwitchRead;  // Current state of the enable switch
-      staircase[F("on")] = on;  // Whether the staircase lights are on
-      staircase[F("topIndex")] = topIndex;  // Current top segment index
-      staircase[F("bottomIndex")] = bottomIndex;  // Current bottom segment index
-      staircase[F("disableIndex")] = disableIndex;  // Current disable segment index
+    // Function to write the runtime metrics to the JSON API
+    void writeMetricsToJson(JsonObject& staircase) {
+      JsonObject m = staircase.createNestedObject("metrics");
+      JsonArray loopUs = m.createNestedArray("loop-us");  // min, avg, max
+      loopUs.add(metrics.loopPasses ? metrics.loopMin : 0);
+      loopUs.add(metrics.loopAvg16 >> 4);
+      loopUs.add(metrics.loopMax);
+      JsonArray hist = m.createNestedArray("loop-hist");  // < 32us, < 64us, ... >= 2048us
+      for (uint8_t i = 0; i < loopBuckets; i++) hist.add(metrics.loopHist[i]);
+      m["passes"]         = metrics.loopPasses;
+      m["latency-ms"]     = metrics.latencyLast;
+      m["latency-max-ms"] = metrics.latencyMax;
+      m["cascade-ms"]     = metrics.cascadeLast;
+      m["cascade-max-ms"] = metrics.cascadeMax;
+      m["triggers"]       = metrics.triggers;
+      m["publishes"]      = metrics.publishes;
+      m["edges"]          = metrics.edges;
+      m["toggles"]        = metrics.toggles;
+      m["udp"]            = metrics.udpAccepted;
+      m["udp-rejected"]   = metrics.udpRejected;
     }
 
-    // Function to allow overriding sensor values via the JSON API
+    // Function to allow overriding sensor values via the JSON API. The keys
+    // at the top address the first staircase, the objects of the staircases
+    // array address each staircase in order.
     void readSensorsFromJson(JsonObject& staircase) {
-      bottomSensorWrite = bottomSensorState || (staircase[F("bottom-sensor")].as<bool>());  // Override bottom sensor state
-      topSensorWrite    = topSensorState    || (staircase[F("top-sensor")].as<bool>());  // Override top sensor state
-      enableSwitchWrite = enableSwitchState || (staircase[F("enable-switch")].as<bool>());  // Override enable switch state
+      flights[0].readSensorsFromJson(staircase);
+      JsonArray list = staircase[FPSTR(_staircases)];
+      if (!list.isNull()) {
+        uint8_t i = 0;
+        for (JsonObject obj : list) {
+          if (i >= numFlights) break;
+          flights[i++].readSensorsFromJson(obj);
+        }
+      }
+      bool value = staircase["enable-switch"].as<bool>();
+      if (!staircase["enable-switch"].isNull()) traceRecord(value ? TRACE_JSON_ON : TRACE_JSON_OFF, traceEnableSwitch, millis());
+      enableSwitchWrite = enableSwitchState || value;  // Override enable switch state
+      wakeup = true;  // Evaluate the overrides in the next loop()
+    }
+
+    // Pin slots: the enable switch, then top trigger, bottom trigger, top echo
+    // and bottom echo of every staircase
+    static const uint8_t maxPins = 1 + 4 * maxFlights;
+    int8_t& pinSlot(uint8_t slot) {
+      if (slot == 0) return enableSwitchPin;
+      Flight &f = flights[(slot - 1) / 4];
+      switch ((slot - 1) % 4) {
+        case 0:  return f.topPIRorTriggerPin;
+        case 1:  return f.bottomPIRorTriggerPin;
+        case 2:  return f.topEchoPin;
+        default: return f.bottomEchoPin;
+      }
+    }
+
+    // Function to list the pins of all slots, trigger pins of distance sensors
+    // are outputs and staircases that are not configured list -1
+    void listPins(PinManagerPinType *pins) {
+      for (uint8_t slot = 0; slot < maxPins; slot++) {
+        uint8_t flight = (slot - 1) / 4;
+        bool used = slot == 0 || flight < numFlights;
+        bool output = slot > 0 && (slot - 1) % 4 < 2 && flights[flight].distanceSensor((slot - 1) % 4 == 0 ? UPPER : LOWER);
+        pins[slot] = { used ? pinSlot(slot) : (int8_t)-1, output };
+      }
+    }
+
+    // Function to move the pin allocation from the old slot list to the
+    // current one, touching only the slots that changed. A pin that cannot be
+    // allocated is dropped from its slot. Returns true if any slot changed.
+    bool reallocatePins(const PinManagerPinType *oldPins) {
+      PinManagerPinType pins[maxPins];
+      listPins(pins);
+      bool changed = false;
+      for (uint8_t slot = 0; slot < maxPins; slot++) {
+        if (pins[slot].pin == oldPins[slot].pin && pins[slot].isOutput == oldPins[slot].isOutput) continue;
+        if (!changed) detachSensorInterrupts();  // Before any pin is released
+        changed = true;
+        if (oldPins[slot].pin >= 0) pinManager.deallocatePin(oldPins[slot].pin, PinOwner::UM_AnimatedStaircase);
+      }
+      if (!changed) return false;
+      // Released first, so a pin can move to another slot
+      for (uint8_t slot = 0; slot < maxPins; slot++) {
+        if (pins[slot].pin < 0 || (pins[slot].pin == oldPins[slot].pin && pins[slot].isOutput == oldPins[slot].isOutput)) continue;
+        if (!pinManager.allocatePin(pins[slot].pin, pins[slot].isOutput, PinOwner::UM_AnimatedStaircase)) {
+          DEBUG_PRINTLN(F("Staircase: pin not available, input dropped."));
+          pinSlot(slot) = -1;
+        }
+      }
+      return true;
+    }
+
+    // Function to configure the pins and attach the interrupts of all staircases
+    void configureInputs() {
+      for (uint8_t i = 0; i < numFlights; i++) flights[i].configurePins();
+      pinMode(enableSwitchPin, INPUT);
+      attachSensorInterrupts();
     }
 
     // Function to enable or disable the usermod
     void enable(bool enable) {
       if (enable) {
         DEBUG_PRINTLN(F("Animated Staircase enabled."));
-        DEBUG_PRINT(F("Delay between steps: "));
-        DEBUG_PRINT(segment_delay_ms);
-        DEBUG_PRINT(F(" milliseconds.\nStairs switch off after: "));
-        DEBUG_PRINT(on_time_ms / 1000);
-        DEBUG_PRINTLN(F(" seconds."));
+        DEBUG_PRINT(F("Staircases: "));
+        DEBUG_PRINTLN(numFlights);
 
         // Configure pins for sensors and switches
-        pinMode(bottomPIRorTriggerPin, INPUT);
-        pinMode(topPIRorTriggerPin, INPUT);
-        pinMode(enableSwitchPin, INPUT);
+        configureInputs();
 
-        // Set the segment IDs for the staircase
-        minSegmentId = strip.getMainSegmentId(); 
-        maxSegmentId = strip.getLastActiveSegmentId() + 1;
-        topIndex = maxSegmentId;
-        bottomIndex = disableIndex = minSegmentId - 1;
+        // Take the enable switch as it is, so the lights are not switched off
+        // while its debounce filter qualifies
+        bool level = enableSwitchPin < 0 ? false : digitalRead(enableSwitchPin);
+        enableFilter.raw = enableFilter.stable = level;
+        enableSwitchRead = enableSwitchState = level || enableSwitchWrite;
 
-        // Adjust the strip transition time
-        transitionDelay = segment_delay_ms;
-        strip.setTransition(segment_delay_ms);
-        strip.trigger();
+        // Set the segment IDs for the staircases
+        refreshSegments();
+        // All segments are on while the usermod is disabled, hold them
+        // with a fully lit wavefront until the on-time expires
+        unsigned long now = millis();
+        for (uint8_t i = 0; i < numFlights; i++) flights[i].holdSteps(now);
+        settleFades();
 
-        on = true;  // Turn on the lights
+        // Adjust the strip transition time
+        unsigned long stepDelay = flights[0].stepDelayFor(flights[0].lastSensor);
+        stepTransition = transitionDelay = stepDelay;
+        strip.setTransition(stepDelay);
+        triggerStrip();
       } else {
+        detachSensorInterrupts();
+
         // Toggle power on if necessary when disabling
-        if (togglePower && !on && offMode) toggleOnOff(); 
+        if (togglePower && !anyOn() && offMode) togglePowerState();
+
+        // Show all steps again in single segment mode
+        for (uint8_t i = 0; i < numFlights; i++) flights[i].desiredMask = flights[i].appliedMask = flights[i].fullMask();
+        settleFades();
 
         // Restore segment options and force update the strip
         for (int i = 0; i <= strip.getLastActiveSegmentId(); i++) {
           Segment &seg = strip.getSegment(i);
-          if (!seg.isActive()) continue; 
+          if (!seg.isActive()) continue;
           seg.setOption(SEG_OPTION_ON, true);
         }
-        strip.trigger();  
-        stateChanged = true;  
-        colorUpdated(CALL_MODE_DIRECT_CHANGE);
+        commitSegments();
         DEBUG_PRINTLN(F("Animated Staircase disabled."));
       }
       enabled = enable;  // Update the enabled state
+      wakeup = true;     // Reschedule from scratch
     }
 
   public:
+    Staircase_Usermod() {
+      for (uint8_t i = 0; i < maxFlights; i++) {
+        flights[i].um = this;
+        flights[i].index = i;
+      }
+      // No interrupts are attached before the first setup()
+      for (uint8_t i = 0; i < maxSensors; i++) isrPin[i] = echoIsrPin[i] = -1;
+    }
+
     // Setup function to initialize the usermod
     void setup() {
       // Standardize invalid pin numbers to -1
-      if (topPIRorTriggerPin    < 0) topPIRorTriggerPin    = -1;
-      if (bottomPIRorTriggerPin < 0) bottomPIRorTriggerPin = -1;
       if (enableSwitchPin < 0) enableSwitchPin = -1;
+      for (Flight &f : flights) f.normalizePins();
 
       // Allocate pins for sensors and switches
-      PinManagerPinType pins[3] = {
-        { topPIRorTriggerPin, false },
-        { bottomPIRorTriggerPin, false },
-        { enableSwitchPin, false },
-      };
+      PinManagerPinType pins[maxPins];
+      listPins(pins);
       // Allocate pins and disable usermod if allocation fails
-      if (!pinManager.allocateMultiplePins(pins, 3, PinOwner::UM_AnimatedStaircase)) {
-        topPIRorTriggerPin = -1;
-        bottomPIRorTriggerPin = -1;
+      if (!pinManager.allocateMultiplePins(pins, maxPins, PinOwner::UM_AnimatedStaircase)) {
         enableSwitchPin = -1;
+        for (Flight &f : flights) {
+          f.topPIRorTriggerPin = -1;
+          f.bottomPIRorTriggerPin = -1;
+          f.topEchoPin = -1;
+          f.bottomEchoPin = -1;
+        }
         enabled = false;
       }
       enable(enabled);  // Enable the usermod based on the stored state
@@ -316,12 +1711,78 @@ class Animated_Staircase : public Usermod {
 
     // Main loop function to handle the usermod logic
     void loop() {
-      if (!enabled || strip.isUpdating()) return;  // Exit if the usermod is disabled or the strip is updating
-      minSegmentId = strip.getMainSegmentId();  
-      maxSegmentId = strip.getLastActiveSegmentId() + 1;
-      checkSensors();  // Check the sensors for state changes
-      if (on) autoPowerOff();  // Automatically power off the lights if necessary
-      updateSwipe();  // Update the swipe effect
+      if (!enabled) return;  // Exit if the usermod is disabled
+      unsigned long now = millis();
+      // Nothing to do before the deadline unless a sensor edge or another event arrived
+      if (!wakeup && !echoReady && edgeHead == edgeTail && (long)(now - nextDeadline) < 0) return;
+      if (strip.isUpdating()) return;  // Exit if the strip is updating
+      uint32_t started = micros();  // Time the pass for the metrics, the socket read included
+      if (udpActive && (long)(now - lastUdpPoll) >= udpPollInterval) {
+        lastUdpPoll = now;
+        receiveUdp(now);  // Remote sensors are checked with the local ones below
+      }
+
+      // Only rescan the segment table when the layout may have changed
+      if (segmentsDirty || strip.getSegmentsNum() != cachedSegmentsNum) refreshSegments();
+      checkSensors(now);  // Check the sensors for state changes
+      for (uint8_t i = 0; i < numFlights; i++) {
+        if (flights[i].isOn()) flights[i].autoPowerOff(now);  // Automatically power off the lights if necessary
+      }
+
+      // Update the swipe effect of every staircase, WLED is notified once for all of them
+      bool animating = anyAnimating();
+      bool changed = false;
+      for (uint8_t i = 0; i < numFlights; i++) changed |= flights[i].updateSwipe(now);
+      if (changed) commitSegments();
+
+      // Toggle power off if necessary once the last wavefront of all staircases has finished
+      if (animating && !anyAnimating() && !anyOn() && togglePower && !offMode) togglePowerState();
+
+      if (singleSegment) updateFades(now);  // Fade the steps in single segment mode
+      for (uint8_t i = 0; i < numFlights; i++) flights[i].publishMqtt(now);  // Publish coalesced changes
+
+      wakeup = false;
+      nextDeadline = computeDeadline(now);
+      recordLoopTime(micros() - started);
+    }
+
+    /*
+     * millis() at which loop() has work to do again. loop() returns right away
+     * before this time unless an input event arrives, so the difference to
+     * millis() is how long the usermod is truly idle.
+     */
+    unsigned long getNextDeadline() const {
+      return wakeup ? millis() : nextDeadline;
+    }
+
+    /*
+     * Renders the step levels on top of the effect in single segment mode.
+     * Fully lit steps are left untouched.
+     */
+    void handleOverlayDraw() {
+      if (!enabled || !singleSegment) return;
+      for (uint8_t i = 0; i < flights[0].stepCount(); i++) {
+        if (stepLevel[i] == 255) continue;
+        uint8_t bri = fadeBrightness(stepLevel[i]);
+        for (uint16_t led = stepStart[i]; led < stepStart[i + 1]; led++) {
+          strip.setPixelColor(led, bri ? color_fade(strip.getPixelColor(led), bri) : 0);
+        }
+      }
+    }
+
+    /*
+     * Called by WLED whenever the state changes (segment edits, presets, ...).
+     * Invalidates the cached step lists unless the change was our own commit.
+     */
+    void onStateChange(uint8_t /*mode*/) {
+      if (!committing) segmentsDirty = wakeup = true;
+    }
+
+    /*
+     * Called by WLED when the network is up, binds the remote sensor socket.
+     */
+    void connected() {
+      startUdp();
     }
 
     // Function to return the unique ID of the usermod
@@ -331,39 +1792,56 @@ class Animated_Staircase : public Usermod {
     /**
      * Handle incoming MQTT messages
      * Topic contains stripped topic (part after /wled/MAC)
-     * Topic should look like: /swipe with a message of [up|down]
+     * Topic should look like: /swipe<topic-suffix> with a message of [up|down]
      */
     bool onMqttMessage(char* topic, char* payload) {
-      if (strlen(topic) == 6 && strncmp_P(topic, PSTR("/swipe"), 6) == 0) {
-        String action = payload;
-        if (action == "up") {
-          bottomSensorWrite = true;  // Simulate a bottom sensor activation
-          return true;
-        } else if (action == "down") {
-          topSensorWrite = true;  // Simulate a top sensor activation
-          return true;
-        } else if (action == "on") {
-          enable(true);  // Enable the usermod
-          return true;
-        } else if (action == "off") {
-          enable(false);  // Disable the usermod
-          return true;
+      if (strncmp_P(topic, PSTR("/swipe"), 6) != 0) return false;
+      for (uint8_t i = 0; i < numFlights; i++) {
+        Flight &f = flights[i];
+        if (strcmp(topic + 6, f.topicSuffix) != 0) continue;  // Another staircase
+        // Compare the payload in place, no String allocation per message
+        uint8_t command;
+        if (strcmp_P(payload, PSTR("up")) == 0) command = 0;
+        else if (strcmp_P(payload, PSTR("down")) == 0) command = 1;
+        else if (strcmp_P(payload, PSTR("on")) == 0) command = 2;
+        else if (strcmp_P(payload, PSTR("off")) == 0) command = 3;
+        else return false;
+        traceRecord(TRACE_MQTT, i * 4 + command, millis());
+        switch (command) {
+          case 0: f.bottomSensorWrite = wakeup = true; break;  // Simulate a bottom sensor activation
+          case 1: f.topSensorWrite = wakeup = true; break;  // Simulate a top sensor activation
+          case 2: enable(true); break;  // Enable the usermod
+          case 3: enable(false); break;  // Disable the usermod
         }
+        return true;
       }
       return false;
     }
 
     /**
-     * Subscribe to MQTT topic for controlling the usermod
+     * Subscribe to the swipe topics of all staircases, build the topics used
+     * for publishing, so they are not formatted per message, and force the
+     * next publish of their states
      */
-    void onMqttConnect(bool sessionPresent) {
+    void onMqttConnect(bool /*sessionPresent*/) {
+      if (mqttDeviceTopic[0] == 0) {
+        for (Flight &f : flights) f.stateTopic[0] = 0;  // Nothing to publish to
+        return;
+      }
       // Subscribe to the relevant MQTT topics
       char subuf[64];
-      if (mqttDeviceTopic[0] != 0) {
-        strcpy(subuf, mqttDeviceTopic);
-        strcat_P(subuf, PSTR("/swipe"));
+      for (uint8_t i = 0; i < numFlights; i++) {
+        Flight &f = flights[i];
+        f.buildTopics();
+        snprintf_P(subuf, sizeof(subuf), PSTR("%s/swipe%s"), mqttDeviceTopic, f.topicSuffix);
         mqtt->subscribe(subuf, 0);
+
+        f.publishedMotion[0] = !f.topSensorState;  // Force a publish
+        f.publishedMotion[1] = !f.bottomSensorState;
+        f.statePublished = false;  // Refresh the retained state
+        f.queueMqtt(millis());
       }
+      wakeup = true;
     }
 #endif
 
@@ -373,8 +1851,25 @@ class Animated_Staircase : public Usermod {
       if (staircase.isNull()) {
         staircase = root.createNestedObject(FPSTR(_name));  // Create a nested JSON object if it doesn't exist
       }
-      writeSensorsToJson(staircase);  // Write the current sensor states to the JSON object
-      DEBUG_PRINTLN(F("Staircase sensor state exposed in API."));
+      if (!compactState) {
+        flights[0].writeSensorsToJson(staircase);  // Write the current sensor states to the JSON object
+        staircase["enable-switch"] = enableSwitchRead;  // Current state of the enable switch
+      }
+      flights[0].writeCompactStatus(staircase);  // Packed status for dashboards polling many staircases
+      if (numFlights > 1) {
+        // Every staircase in order, the first one also stays at the top for existing clients
+        JsonArray list = staircase.createNestedArray(FPSTR(_staircases));
+        for (uint8_t i = 0; i < numFlights; i++) {
+          JsonObject obj = list.createNestedObject();
+          if (!compactState) flights[i].writeSensorsToJson(obj);
+          flights[i].writeCompactStatus(obj);
+        }
+      }
+      if (metricsInState) writeMetricsToJson(staircase);  // Runtime metrics, if enabled
+      if (traceRequested) {
+        writeTraceToJson(staircase);  // Input trace, once per request
+        traceRequested = false;
+      }
     }
 
     /*
@@ -389,10 +1884,13 @@ class Animated_Staircase : public Usermod {
         if (staircase[FPSTR(_enabled)].is<bool>()) {
           en = staircase[FPSTR(_enabled)].as<bool>();  // Read the enabled state from JSON
         } else {
-          String str = staircase[FPSTR(_enabled)];  // Checkbox -> off or on
-          en = (bool)(str!="off"); // Convert to boolean (off is guaranteed to be present)
+          const char *str = staircase[FPSTR(_enabled)] | "";  // Checkbox -> off or on
+          en = strcmp(str, "off") != 0; // Convert to boolean (off is guaranteed to be present)
         }
         if (en != enabled) enable(en);  // Enable or disable based on JSON input
+        if (staircase["reset-metrics"] | false) resetMetrics();  // Reset the runtime metrics
+        if (staircase["trace"] | false) traceRequested = true;  // Return the input trace with the next state
+        if (staircase["trace-clear"] | false) traceClear();  // Start a new trace
         readSensorsFromJson(staircase);  // Read sensor states from JSON
         DEBUG_PRINTLN(F("Staircase sensor state read from API."));
       }
@@ -415,24 +1913,40 @@ class Animated_Staircase : public Usermod {
         staircase = root.createNestedObject(FPSTR(_name));  // Create a nested JSON object if it doesn't exist
       }
       staircase[FPSTR(_enabled)]                   = enabled;  // Save the enabled state
-      staircase[FPSTR(_segmentDelay)]              = segment_delay_ms;  // Save the segment delay
-      staircase[FPSTR(_onTime)]                    = on_time_ms / 1000;  // Save the on-time (in seconds)
-      staircase[FPSTR(_topPIRorTrigger_pin)]       = topPIRorTriggerPin;  // Save the top sensor pin
-      staircase[FPSTR(_bottomPIRorTrigger_pin)]    = bottomPIRorTriggerPin;  // Save the bottom sensor pin
       staircase[FPSTR(_enableSwitch_pin)]          = enableSwitchPin;  // Save the enable switch pin
       staircase[FPSTR(_togglePower)]               = togglePower;  // Save the toggle power option
+      staircase[FPSTR(_useInterrupts)]             = useInterrupts;  // Save the sensor capture mode
+      staircase[FPSTR(_singleSegment)]             = singleSegment;  // Save the render mode
+      staircase[FPSTR(_mqttCoalesce)]              = mqtt_coalesce_ms;  // Save the MQTT coalescing window
+      staircase[FPSTR(_compactState)]              = compactState;  // Save the JSON state format
+      staircase[FPSTR(_minPulse)]                  = min_pulse_ms;  // Save the minimum pulse width
+      staircase[FPSTR(_releaseHold)]               = release_ms;  // Save the release hold-off
+      staircase[FPSTR(_metricsInState)]            = metricsInState;  // Save whether metrics are in the JSON state
+      staircase[FPSTR(_adaptiveTiming)]            = adaptiveTiming;  // Save the adaptive timing option
+      staircase[FPSTR(_minStep)]                   = min_step_ms;  // Save the lower bound of the learned step delay
+      staircase[FPSTR(_maxStep)]                   = max_step_ms;  // Save the upper bound of the learned step delay
+      staircase[FPSTR(_leadSteps)]                 = leadSteps;  // Save the lead of the light in steps
+      staircase[FPSTR(_traceInputs)]               = traceInputs;  // Save whether inputs are traced
+      staircase[FPSTR(_udpPort)]                   = udpPort;  // Save the remote sensor port
+      staircase[FPSTR(_occupancyOff)]              = occupancyOff;  // Save whether an empty staircase switches off
+      staircase[FPSTR(_ledSteps)]                  = ledSteps;  // Save the number of steps in single segment mode
+      JsonArray map = staircase.createNestedArray(FPSTR(_stepLeds));  // Save the LEDs per step
+      for (uint8_t i = 0; i < min(ledSteps, (uint8_t)maxSteps); i++) map.add(stepLeds[i]);
+      if (maxFlights > 1) staircase[FPSTR(_staircases)] = numFlights;  // Save the number of staircases
+      for (uint8_t i = 0; i < numFlights; i++) flights[i].writeConfig(staircase);  // Save the staircases, flat keys each
       DEBUG_PRINTLN(F("Staircase config saved."));
     }
 
     /*
     * Reads the configuration from internal flash memory before setup() is called.
-    * 
+    *
     * The function should return true if configuration was successfully loaded or false if there was no configuration.
     */
     bool readFromConfig(JsonObject& root) {
-      int8_t oldTopAPin = topPIRorTriggerPin;
-      int8_t oldBottomAPin = bottomPIRorTriggerPin;
-      int8_t oldEnableSwitchPin = enableSwitchPin;
+      PinManagerPinType oldPins[maxPins];
+      listPins(oldPins);
+      uint8_t oldFlights = numFlights;
+      bool oldSingleSegment = singleSegment;
 
       JsonObject top = root[FPSTR(_name)];
       if (top.isNull()) {
@@ -442,35 +1956,99 @@ class Animated_Staircase : public Usermod {
       }
 
       // Load configuration values from the JSON object
-      enabled   = top[FPSTR(_enabled)] | enabled;
-      segment_delay_ms = top[FPSTR(_segmentDelay)] | segment_delay_ms;
-      segment_delay_ms = (unsigned long) min((unsigned long)10000,max((unsigned long)10,(unsigned long)segment_delay_ms));  // max delay 10s
-
-      on_time_ms = top[FPSTR(_onTime)] | on_time_ms/1000;
-      on_time_ms = min(900,max(1,(int)on_time_ms)) * 1000; // min 1s, max 15min
-
-      topPIRorTriggerPin = top[FPSTR(_topPIRorTrigger_pin)] | topPIRorTriggerPin;
-      bottomPIRorTriggerPin = top[FPSTR(_bottomPIRorTrigger_pin)] | bottomPIRorTriggerPin;
+      bool en   = top[FPSTR(_enabled)] | enabled;
+      if (!initDone) enabled = en;  // Applied by setup()
       enableSwitchPin = top[FPSTR(_enableSwitch_pin)] | enableSwitchPin;
       togglePower = top[FPSTR(_togglePower)] | togglePower;  // staircase toggles power on/off
+      bool oldUseInterrupts = useInterrupts;
+      useInterrupts = top[FPSTR(_useInterrupts)] | useInterrupts;  // capture sensor edges by interrupt
+      singleSegment = top[FPSTR(_singleSegment)] | singleSegment;  // render the steps inside the first segment
+      mqtt_coalesce_ms = top[FPSTR(_mqttCoalesce)] | mqtt_coalesce_ms;
+      mqtt_coalesce_ms = min((unsigned long)5000, (unsigned long)mqtt_coalesce_ms);  // max window 5s
+      compactState = top[FPSTR(_compactState)] | compactState;  // only the packed status in the JSON state
+      min_pulse_ms = min(2000U, (unsigned int)(top[FPSTR(_minPulse)] | min_pulse_ms));  // max 2s
+      release_ms = min(10000U, (unsigned int)(top[FPSTR(_releaseHold)] | release_ms));  // max 10s
+      metricsInState = top[FPSTR(_metricsInState)] | metricsInState;  // runtime metrics in the JSON state
+      adaptiveTiming = top[FPSTR(_adaptiveTiming)] | adaptiveTiming;  // learn the timing from the walking speed
+      min_step_ms = min(10000UL, max(10UL, (unsigned long)(top[FPSTR(_minStep)] | min_step_ms)));  // 10ms to 10s
+      max_step_ms = min(10000UL, max(min_step_ms, (unsigned long)(top[FPSTR(_maxStep)] | max_step_ms)));  // at least min-step-ms
+      leadSteps = min(16, max(0, top[FPSTR(_leadSteps)] | (int)leadSteps));  // 0 to 16 steps
+      bool oldTraceInputs = traceInputs;
+      traceInputs = top[FPSTR(_traceInputs)] | traceInputs;  // record the inputs in the trace buffer
+      if (traceInputs && !oldTraceInputs) traceClear();  // A new recording starts empty
+      uint16_t oldUdpPort = udpPort;
+      udpPort = top[FPSTR(_udpPort)] | udpPort;  // remote sensor datagrams, 0 = off
+      occupancyOff = top[FPSTR(_occupancyOff)] | occupancyOff;  // switch off once the stairs are empty
+      ledSteps = min((int)maxSteps, max(1, top[FPSTR(_ledSteps)] | (int)ledSteps));  // 1 to 64 steps
+      JsonArray map = top[FPSTR(_stepLeds)];
+      uint8_t step = 0;
+      if (!map.isNull()) {
+        for (JsonVariant leds : map) {
+          if (step >= maxSteps) break;
+          stepLeds[step++] = leds | 0;
+        }
+      }
+      while (step < maxSteps) stepLeds[step++] = 0;  // Equal share for the remaining steps
+
+      // The first staircase has its settings at the top, like a config from
+      // before multiple staircases; the others add their index to the keys
+      numFlights = min((int)maxFlights, max(1, top[FPSTR(_staircases)] | (int)numFlights));  // 1 to STAIRS_MAX_STAIRCASES
+      for (uint8_t i = 0; i < numFlights; i++) flights[i].readConfig(top);
+      segmentsDirty = wakeup = true;  // Geometry may have changed
 
       DEBUG_PRINT(FPSTR(_name));
       if (!initDone) {
         // First run: reading from cfg.json
         DEBUG_PRINTLN(F(" config loaded."));
       } else {
-        // Changing parameters from settings page
+        // Changing parameters from settings page. Applied to the running
+        // state: only changed pins are reallocated, cascades in progress
+        // keep going, and enable() only runs if the enabled state changed.
         DEBUG_PRINTLN(F(" config (re)loaded."));
-        bool changed = false;
-        if ((oldTopAPin != topPIRorTriggerPin) ||
-            (oldBottomAPin != bottomPIRorTriggerPin) ||
-            (oldEnableSwitchPin != enableSwitchPin)) {
-          changed = true;
-          pinManager.deallocatePin(oldTopAPin, PinOwner::UM_AnimatedStaircase);
-          pinManager.deallocatePin(oldBottomAPin, PinOwner::UM_AnimatedStaircase);
-          pinManager.deallocatePin(oldEnableSwitchPin, PinOwner::UM_AnimatedStaircase);
+        if (enableSwitchPin < 0) enableSwitchPin = -1;
+        for (Flight &f : flights) f.normalizePins();
+        bool pinsChanged = reallocatePins(oldPins);
+        if (udpPort != oldUdpPort) startUdp();  // Rebind, nothing else depends on the socket
+#ifndef WLED_DISABLE_MQTT
+        if (WLED_MQTT_CONNECTED && mqttDeviceTopic[0] != 0) {
+          bool topicsChanged = false;
+          for (uint8_t i = 0; i < numFlights; i++) topicsChanged |= flights[i].buildTopics();
+          if (topicsChanged) onMqttConnect(false);  // Subscribe to the new swipe topics
+        }
+#endif
+        if (en != enabled) {
+          enable(en);  // Configures the pins itself
+        } else if (enabled) {
+          if (pinsChanged) configureInputs();  // Reconfigure without touching the lights
+          else if (oldUseInterrupts != useInterrupts) attachSensorInterrupts();  // Switch capture mode
+
+          // Staircases added by this config start lit like after enable(),
+          // removed ones are forgotten
+          unsigned long now = millis();
+          if (singleSegment != oldSingleSegment) {
+            // The render mode of the first staircase changed. The overlay
+            // needs its segments on, the step segments take the lit steps.
+            Flight &f = flights[0];
+            if (singleSegment) {
+              for (uint8_t i = 0; i < f.numSteps; i++) setSegmentOn(f.stepSegment[i], true);
+            }
+            refreshSegments();
+            if (!singleSegment) f.updateSegments(now);
+            settleFades();  // No fade across the switch, and no pending fade in segment mode
+            commitSegments();
+          }
+          if (numFlights > oldFlights) refreshSegments();
+          bool changed = false;
+          for (uint8_t i = oldFlights; i < numFlights; i++) {
+            flights[i].holdSteps(now);
+            flights[i].appliedMask = 0;  // Switch on whatever is off
+            changed |= flights[i].updateSegments(now);
+          }
+          if (changed) commitSegments();
+          for (uint8_t i = numFlights; i < oldFlights; i++) flights[i].clearFronts();
+          for (uint8_t i = 0; i < numFlights; i++) flights[i].applyTiming();
+          if (!flights[0].isAnimating()) setStepTransition(flights[0].stepDelayFor(flights[0].lastSensor));  // A running cascade keeps its transition
         }
-        if (changed) setup();  // Re-setup if pins have changed
       }
       return !top[FPSTR(_togglePower)].isNull();  // Return true if toggle power is configured
     }
@@ -487,24 +2065,93 @@ class Animated_Staircase : public Usermod {
 
       JsonArray infoArr = user.createNestedArray(FPSTR(_name));  // Create a JSON array for the staircase info
 
-      String uiDomString = F("<button class=\"btn btn-xs\" onclick=\"requestJson({");
-      uiDomString += FPSTR(_name);
-      uiDomString += F(":{");
-      uiDomString += FPSTR(_enabled);
-      uiDomString += enabled ? F(":false}});\">") : F(":true}});\">");
-      uiDomString += F("<i class=\"icons ");
-      uiDomString += enabled ? "on" : "off";
-      uiDomString += F("\">&#xe08f;</i></button>");
+      // Render the toggle button from the PROGMEM template on the stack,
+      // a char array is copied by ArduinoJson without touching the heap
+      char uiDomString[160];
+      snprintf_P(uiDomString, sizeof(uiDomString), _infoButton, enabled ? "false" : "true", enabled ? "on" : "off");
       infoArr.add(uiDomString);  // Add the UI button for toggling the staircase
+
+      // Runtime metrics, rendered on the stack like the button
+      char line[48];
+      snprintf_P(line, sizeof(line), PSTR("%lu / %lu / %lu us"), (unsigned long)(metrics.loopPasses ? metrics.loopMin : 0),
+                 (unsigned long)(metrics.loopAvg16 >> 4), (unsigned long)metrics.loopMax);
+      user.createNestedArray(F("Staircase loop")).add(line);
+      snprintf_P(line, sizeof(line), PSTR("%lu / %lu ms"), metrics.latencyLast, metrics.latencyMax);
+      user.createNestedArray(F("Staircase latency")).add(line);
+      snprintf_P(line, sizeof(line), PSTR("%lu / %lu ms"), metrics.cascadeLast, metrics.cascadeMax);
+      user.createNestedArray(F("Staircase cascade")).add(line);
+      snprintf_P(line, sizeof(line), PSTR("%lu edges, %lu triggers"), (unsigned long)metrics.edges, (unsigned long)metrics.triggers);
+      user.createNestedArray(F("Staircase events")).add(line);
+      snprintf_P(line, sizeof(line), PSTR("%lu publishes, %lu toggles"), (unsigned long)metrics.publishes, (unsigned long)metrics.toggles);
+      user.createNestedArray(F("Staircase output")).add(line);
     }
 };
 
 // Strings to reduce flash memory usage (used more than twice)
-const char Animated_Staircase::_name[]                      PROGMEM = "staircase";
-const char Animated_Staircase::_enabled[]                   PROGMEM = "enabled";
-const char Animated_Staircase::_segmentDelay[]              PROGMEM = "segment-delay-ms";
-const char Animated_Staircase::_onTime[]                    PROGMEM = "on-time-s";
-const char Animated_Staircase::_topPIRorTrigger_pin[]       PROGMEM = "topPIRorTrigger_pin";
-const char Animated_Staircase::_bottomPIRorTrigger_pin[]    PROGMEM = "bottomPIRorTrigger_pin";
-const char Animated_Staircase::_enableSwitch_pin[]          PROGMEM = "enableSwitch_pin";
-const char Animated_Staircase::_togglePower[]               PROGMEM = "toggle-on-off";
+const char Staircase_Common::_name[]                      PROGMEM = "staircase";
+const char Staircase_Common::_enabled[]                   PROGMEM = "enabled";
+const char Staircase_Common::_segmentDelay[]              PROGMEM = "segment-delay-ms";
+const char Staircase_Common::_onTime[]                    PROGMEM = "on-time-s";
+const char Staircase_Common::_topPIRorTrigger_pin[]       PROGMEM = "topPIRorTrigger_pin";
+const char Staircase_Common::_bottomPIRorTrigger_pin[]    PROGMEM = "bottomPIRorTrigger_pin";
+const char Staircase_Common::_enableSwitch_pin[]          PROGMEM = "enableSwitch_pin";
+const char Staircase_Common::_topEcho_pin[]               PROGMEM = "topEcho_pin";
+const char Staircase_Common::_bottomEcho_pin[]            PROGMEM = "bottomEcho_pin";
+const char Staircase_Common::_topMaxDist[]                PROGMEM = "topMaxDist_cm";
+const char Staircase_Common::_bottomMaxDist[]             PROGMEM = "bottomMaxDist_cm";
+const char Staircase_Common::_togglePower[]               PROGMEM = "toggle-on-off";
+const char Staircase_Common::_useInterrupts[]             PROGMEM = "use-interrupts";
+
+const char Staircase_Common::_singleSegment[]             PROGMEM = "single-segment";
+const char Staircase_Common::_ledSteps[]                  PROGMEM = "led-steps";
+const char Staircase_Common::_stepLeds[]                  PROGMEM = "step-leds";
+const char Staircase_Common::_mqttCoalesce[]              PROGMEM = "mqtt-coalesce-ms";
+const char Staircase_Common::_compactState[]              PROGMEM = "compact-state";
+const char Staircase_Common::_minPulse[]                  PROGMEM = "min-pulse-ms";
+const char Staircase_Common::_releaseHold[]               PROGMEM = "release-ms";
+const char Staircase_Common::_metricsInState[]            PROGMEM = "metrics-in-state";
+const char Staircase_Common::_adaptiveTiming[]            PROGMEM = "adaptive-timing";
+const char Staircase_Common::_minStep[]                   PROGMEM = "min-step-ms";
+const char Staircase_Common::_maxStep[]                   PROGMEM = "max-step-ms";
+const char Staircase_Common::_leadSteps[]                 PROGMEM = "lead-steps";
+const char Staircase_Common::_staircases[]                PROGMEM = "staircases";
+const char Staircase_Common::_firstSegment[]              PROGMEM = "first-segment";
+const char Staircase_Common::_lastSegment[]               PROGMEM = "last-segment";
+const char Staircase_Common::_topicSuffix[]               PROGMEM = "topic-suffix";
+const char Staircase_Common::_traceInputs[]               PROGMEM = "trace-inputs";
+const char Staircase_Common::_udpPort[]                   PROGMEM = "udp-port";
+const char Staircase_Common::_occupancyOff[]              PROGMEM = "occupancy-off";
+
+// Toggle button in the info tab, %s: enabled after the click, icon state
+const char Staircase_Common::_infoButton[] PROGMEM =
+  "<button class=\"btn btn-xs\" onclick=\"requestJson({staircase:{enabled:%s}});\"><i class=\"icons %s\">&#xe08f;</i></button>";
+
+// Smoothstep easing with gamma 2.2, 33 entries for 8 linear levels each
+const uint8_t Staircase_Common::_fadeLut[] PROGMEM = {
+    0,   0,   0,   0,   0,   1,   1,   3,   4,   7,  10,  15,  20,  27,  35,  45,
+   55,  68,  81,  95, 110, 126, 143, 159, 175, 191, 206, 220, 232, 241, 249, 253,
+  255
+};
+
+// Sensor edge queue shared with the interrupt handlers, one per variant.
+// The pin tables are set to -1 by the constructor.
+#define STAIRCASE_TEMPLATE template<uint8_t Steps, uint8_t Ends, uint8_t Sensors>
+#define STAIRCASE Staircase_Usermod<Steps, Ends, Sensors>
+STAIRCASE_TEMPLATE volatile unsigned long STAIRCASE::edgeTime[STAIRCASE::edgeQueueSize];
+STAIRCASE_TEMPLATE volatile uint8_t       STAIRCASE::edgeLevel[STAIRCASE::edgeQueueSize];
+STAIRCASE_TEMPLATE volatile uint8_t       STAIRCASE::edgeHead     = 0;
+STAIRCASE_TEMPLATE volatile uint8_t       STAIRCASE::edgeTail     = 0;
+STAIRCASE_TEMPLATE volatile bool          STAIRCASE::edgeOverflow = false;
+STAIRCASE_TEMPLATE int8_t                 STAIRCASE::isrPin[STAIRCASE::maxSensors];
+
+// Echo timing shared with the distance sensor interrupt handlers
+STAIRCASE_TEMPLATE volatile unsigned long STAIRCASE::echoRise[STAIRCASE::maxSensors];
+STAIRCASE_TEMPLATE volatile unsigned long STAIRCASE::echoWidth[STAIRCASE::maxSensors];
+STAIRCASE_TEMPLATE volatile bool          STAIRCASE::echoReady    = false;
+STAIRCASE_TEMPLATE int8_t                 STAIRCASE::echoIsrPin[STAIRCASE::maxSensors];
+#undef STAIRCASE
+#undef STAIRCASE_TEMPLATE
+
+// The runtime configured staircase: step count from the segments or led-steps,
+// both ends, PIR and ultrasonic sensors
+typedef Staircase_Usermod<> Animated_Staircase;